@@ -1,6 +1,9 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System;
+using System.Collections.Generic;
 using System.IO;
+using EpicGames.Core;
 using UnrealBuildTool;
 
 public class IGI : ModuleRules
@@ -10,6 +13,42 @@ public class IGI : ModuleRules
         return Target.Platform == UnrealTargetPlatform.Win64;
     }
 
+    // Whether the GPT backend packaged for this target can run a model of this quantization
+    protected virtual bool IsModelVariantSupported(ReadOnlyTargetRules Target, string Quantization)
+    {
+        // The GGML CUDA backend runs every GGUF quantization
+        return true;
+    }
+
+    // Defaults of UIGISettings::ModelName, and of the model the runtime falls back to when no variant of it is found
+    private const string DefaultModelName = "nemotron-4-mini-4b-instruct";
+    private const string FallbackModelGUID = "{01F43B70-CE23-42CA-9606-74E80C5ED0B6}";
+
+    // Whether a model directory holds a variant of ModelName, matched on its config name like FindIGIModelVariants does
+    private static bool IsVariantOfModel(string ModelPath, string ModelName)
+    {
+        JsonObject Config;
+        string Name;
+        return JsonObject.TryRead(new FileReference(Path.Combine(ModelPath, "nvigi.model.config.json")), out Config)
+            && Config.TryGetStringField("name", out Name) && Name.StartsWith(ModelName, StringComparison.OrdinalIgnoreCase);
+    }
+
+    // Quantization of a model variant, from its config or else from its weights' file name
+    private static string GetModelVariantQuantization(string ModelPath, string WeightsPath)
+    {
+        JsonObject Config;
+        string Quantization;
+        if (JsonObject.TryRead(new FileReference(Path.Combine(ModelPath, "nvigi.model.config.json")), out Config) && Config.TryGetStringField("quantization", out Quantization))
+        {
+            return Quantization;
+        }
+
+        // nemotron-4-mini-4b-instruct_q4_0.gguf -> q4_0
+        string BaseName = Path.GetFileNameWithoutExtension(WeightsPath);
+        int Separator = BaseName.IndexOf('_');
+        return Separator >= 0 ? BaseName.Substring(Separator + 1) : "";
+    }
+
     public IGI(ReadOnlyTargetRules Target) : base(Target)
 	{
         if (!IsSupportedTarget(Target)) return;
@@ -48,9 +87,13 @@ public class IGI : ModuleRules
 				// ... add private dependencies that you statically link with here ...	
                 "Core",
                 "CoreUObject",
+                "DeveloperSettings",
                 "Engine",
+                "Json",
+                "Networking",
                 "Projects",
 				"RHI",
+                "Sockets",
             }
 			);
 		
@@ -63,16 +106,26 @@ public class IGI : ModuleRules
 			});
 		}
 
+        // LoRA adapters need a GPT plugin whose parameters can name them
+        string GPTHeaderPath = Path.Combine([PluginDirectory, "ThirdParty", "nvigi_pack", "plugins", "sdk", "include", "nvigi_gpt.h"]);
+        bool bWithGPTLoRA = File.Exists(GPTHeaderPath) && File.ReadAllText(GPTHeaderPath).Contains("loraNames");
+        PrivateDefinitions.Add("IGI_WITH_GPT_LORA=" + (bWithGPTLoRA ? "1" : "0"));
+
+        // Free video memory query on the inference adapter, and a device of our own on it when the engine renders elsewhere
+        PublicSystemLibraries.Add("dxgi.lib");
+        PublicSystemLibraries.Add("d3d12.lib");
+
         PublicDefinitions.Add("AIM_CORE_BINARY_NAME=TEXT(\"nvigi.core.framework.dll\")");
 
         string PluginsBinaryPath = Path.Combine([PluginDirectory, "ThirdParty", "nvigi_pack", "plugins", "sdk", "bin", "x64"]);
-        string GPTModelPath = Path.Combine([PluginDirectory, "ThirdParty", "nvigi_pack", "plugins", "sdk", "data", "nvigi.models", "nvigi.plugin.gpt.ggml", "{8E31808B-C182-4016-9ED8-64804FF5B40D}"]);
+        string GPTModelsPath = Path.Combine([PluginDirectory, "ThirdParty", "nvigi_pack", "plugins", "sdk", "data", "nvigi.models", "nvigi.plugin.gpt.ggml"]);
 
         // Core framework DLL
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "nvigi.core.framework.dll"));
 
         // GPT feature + dependencies
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "nvigi.plugin.gpt.ggml.cuda.dll"));
+        RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "nvigi.plugin.gpt.ggml.cpu.dll"));
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "cig_scheduler_settings.dll"));
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "cublas64_12.dll"));
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "cublasLt64_12.dll"));
@@ -80,7 +133,72 @@ public class IGI : ModuleRules
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "nvigi.plugin.hwi.common.dll"));
         RuntimeDependencies.Add(Path.Combine(PluginsBinaryPath, "nvigi.plugin.hwi.cuda.dll"));
 
-        RuntimeDependencies.Add(Path.Combine(GPTModelPath, "nemotron-4-mini-4b-instruct_q4_0.gguf"));
-        RuntimeDependencies.Add(Path.Combine(GPTModelPath, "nvigi.model.config.json"));
+        // GPT model variants of the configured model; the runtime picks one of them to fit the machine (see UIGISettings).
+        // The settings are read from the target platform's config, so each platform ships only what it can use.
+        List<string> PackagedQuantizations = null;
+        string ModelName = null;
+        string ModelGUID = null;
+        if (Target.ProjectFile != null)
+        {
+            ConfigHierarchy GameIni = ConfigCache.ReadHierarchy(ConfigHierarchyType.Game, DirectoryReference.FromFile(Target.ProjectFile), Target.Platform);
+            GameIni.GetArray("/Script/IGI.IGISettings", "PackagedQuantizations", out PackagedQuantizations);
+            GameIni.GetString("/Script/IGI.IGISettings", "ModelName", out ModelName);
+            GameIni.GetString("/Script/IGI.IGISettings", "ModelGUID", out ModelGUID);
+        }
+        if (string.IsNullOrEmpty(ModelName))
+        {
+            ModelName = DefaultModelName;
+        }
+
+        if (Directory.Exists(GPTModelsPath))
+        {
+            // A configured GUID is loaded as is, without variant selection; so is the fallback when no variant is found
+            List<string> ModelPaths = new List<string>();
+            bool bLoadedAsIs = !string.IsNullOrEmpty(ModelGUID);
+            if (!bLoadedAsIs)
+            {
+                foreach (string ModelPath in Directory.EnumerateDirectories(GPTModelsPath))
+                {
+                    if (IsVariantOfModel(ModelPath, ModelName))
+                    {
+                        ModelPaths.Add(ModelPath);
+                    }
+                }
+
+                if (ModelPaths.Count == 0)
+                {
+                    ModelGUID = FallbackModelGUID;
+                    bLoadedAsIs = true;
+                }
+            }
+            if (bLoadedAsIs && Directory.Exists(Path.Combine(GPTModelsPath, ModelGUID)))
+            {
+                ModelPaths.Add(Path.Combine(GPTModelsPath, ModelGUID));
+            }
+
+            foreach (string ModelPath in ModelPaths)
+            {
+                bool bAnyPackaged = false;
+                foreach (string WeightsPath in Directory.EnumerateFiles(ModelPath, "*.gguf"))
+                {
+                    string Quantization = GetModelVariantQuantization(ModelPath, WeightsPath);
+                    if (bLoadedAsIs
+                        || ((PackagedQuantizations == null || PackagedQuantizations.Count == 0 || PackagedQuantizations.Contains(Quantization))
+                            && IsModelVariantSupported(Target, Quantization)))
+                    {
+                        RuntimeDependencies.Add(WeightsPath);
+                        bAnyPackaged = true;
+                    }
+                }
+
+                if (bAnyPackaged)
+                {
+                    RuntimeDependencies.Add(Path.Combine(ModelPath, "nvigi.model.config.json"));
+                }
+            }
+        }
+
+        // Dialogue banks baked by the IGIBakeDialogue commandlet; staged as loose files, as they are memory mapped
+        RuntimeDependencies.Add("$(ProjectDir)/Content/IGI/*.igibake", StagedFileType.NonUFS);
     }
 }
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Inference adapter selection. Depends on nothing but Core: no UObject, nvigi or RHI types, so that it can be exercised with
+ * mocked adapter lists (see Tests/IGIAdapterSelectionTests.cpp). FIGICore translates nvigi's adapters and UIGISettings into it.
+ */
+
+/** Mirrors EIGIAdapterPolicy, which is a UENUM */
+enum class EIGIAdapterSelection : uint8
+{
+    HighestArchitecture,
+    MostVideoMemory,
+    PreferredVendor,
+    AdapterIndex,
+};
+
+/** What adapter selection needs to know about an adapter */
+struct FIGIAdapterInfo
+{
+    uint32 Vendor{ 0 };
+    uint32 Architecture{ 0 };
+    uint64 DedicatedMemoryMB{ 0 };
+    bool bIsPhysical{ false };
+    bool bIsRenderAdapter{ false };
+};
+
+struct FIGIAdapterSelectionPolicy
+{
+    EIGIAdapterSelection Policy{ EIGIAdapterSelection::HighestArchitecture };
+    uint32 PreferredVendorId{ 0 };
+    int32 AdapterIndex{ 0 };
+    bool bAvoidRenderAdapter{ false };
+};
+
+/** Whether an adapter is hardware rather than a placeholder; VendorType is nvigi::VendorId or a mock with the same members */
+template <typename VendorType>
+bool IsPhysicalIGIAdapterVendor(VendorType Vendor)
+{
+    // Both must differ; with || every adapter counted as physical
+    return Vendor != VendorType::eAny && Vendor != VendorType::eNone;
+}
+
+/** Whether two adapter LUIDs are the same adapter; LUID or nvigi's copy of it, or mocks with the same members */
+template <typename LuidTypeA, typename LuidTypeB>
+bool IsSameIGIAdapterLuid(const LuidTypeA& A, const LuidTypeB& B)
+{
+    return A.LowPart == B.LowPart && A.HighPart == B.HighPart;
+}
+
+/** Picks the inference adapter; INDEX_NONE when Adapters is empty, the first adapter when none is physical */
+inline int32 SelectIGIAdapter(const TArray<FIGIAdapterInfo>& Adapters, const FIGIAdapterSelectionPolicy& Policy)
+{
+    if (Policy.Policy == EIGIAdapterSelection::AdapterIndex && Adapters.IsValidIndex(Policy.AdapterIndex))
+    {
+        return Policy.AdapterIndex;
+    }
+
+    bool bHasOtherAdapter{ false };
+    for (const FIGIAdapterInfo& Adapter : Adapters)
+    {
+        bHasOtherAdapter |= Adapter.bIsPhysical && !Adapter.bIsRenderAdapter;
+    }
+    const bool bSkipRenderAdapter = Policy.bAvoidRenderAdapter && bHasOtherAdapter;
+
+    auto IsBetter = [&Policy](const FIGIAdapterInfo& Candidate, const FIGIAdapterInfo& Best)
+        {
+            if (Policy.Policy == EIGIAdapterSelection::PreferredVendor && (Candidate.Vendor == Policy.PreferredVendorId) != (Best.Vendor == Policy.PreferredVendorId))
+            {
+                return Candidate.Vendor == Policy.PreferredVendorId;
+            }
+            if (Policy.Policy == EIGIAdapterSelection::MostVideoMemory && Candidate.DedicatedMemoryMB != Best.DedicatedMemoryMB)
+            {
+                return Candidate.DedicatedMemoryMB > Best.DedicatedMemoryMB;
+            }
+            return Candidate.Architecture > Best.Architecture;
+        };
+
+    int32 BestIndex{ INDEX_NONE };
+    for (int32 Index = 0; Index < Adapters.Num(); ++Index)
+    {
+        const FIGIAdapterInfo& Adapter = Adapters[Index];
+        if (!Adapter.bIsPhysical || (bSkipRenderAdapter && Adapter.bIsRenderAdapter))
+        {
+            continue;
+        }
+
+        if (BestIndex == INDEX_NONE || IsBetter(Adapter, Adapters[BestIndex]))
+        {
+            BestIndex = Index;
+        }
+    }
+
+    // No physical adapter; fall back to the first one so CPU plugins remain usable
+    if (BestIndex == INDEX_NONE && Adapters.Num() > 0)
+    {
+        BestIndex = 0;
+    }
+
+    return BestIndex;
+}
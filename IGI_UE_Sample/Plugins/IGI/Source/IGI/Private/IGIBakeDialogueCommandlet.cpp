@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIBakeDialogueCommandlet.h"
+
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+#include "IGIBakedDialogue.h"
+#include "IGIGPT.h"
+#include "IGILog.h"
+#include "IGIModule.h"
+
+namespace
+{
+    // Seed of the lines that name none, when the manifest names none either
+    constexpr int32 DEFAULT_BAKE_SEED{ 1 };
+}
+
+UIGIBakeDialogueCommandlet::UIGIBakeDialogueCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+int32 UIGIBakeDialogueCommandlet::Main(const FString& Params)
+{
+    FString ManifestPath;
+    if (!FParse::Value(*Params, TEXT("Manifest="), ManifestPath))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("Usage: -run=IGIBakeDialogue -Manifest=<prompts.json> [-Output=<bank.igibake>] [-Seed=<seed>]"));
+        return 1;
+    }
+
+    FString OutputPath = FPaths::Combine(FPaths::ProjectContentDir(), TEXT("IGI"), FPaths::GetBaseFilename(ManifestPath) + FIGIBakedDialogue::EXTENSION);
+    FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+    FString ManifestText;
+    TSharedPtr<FJsonObject> Manifest;
+    if (!FFileHelper::LoadFileToString(ManifestText, *ManifestPath)
+        || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ManifestText), Manifest) || !Manifest.IsValid())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to read the manifest %s"), ANSI_TO_TCHAR(__FUNCTION__), *ManifestPath);
+        return 1;
+    }
+
+    int32 DefaultSeed{ DEFAULT_BAKE_SEED };
+    Manifest->TryGetNumberField(TEXT("seed"), DefaultSeed);
+    FParse::Value(*Params, TEXT("Seed="), DefaultSeed);
+
+    const TArray<TSharedPtr<FJsonValue>>* Lines{ nullptr };
+    if (!Manifest->TryGetArrayField(TEXT("lines"), Lines))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: %s has no lines"), ANSI_TO_TCHAR(__FUNCTION__), *ManifestPath);
+        return 1;
+    }
+
+    FIGIModule& Module = FIGIModule::Get();
+    if (!Module.IsIGICoreLoaded() && !Module.LoadIGICore())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to load the IGI core"), ANSI_TO_TCHAR(__FUNCTION__));
+        return 1;
+    }
+
+    // In this process whatever the host mode, so that the seeds apply
+    FIGIGPT GPT(&Module);
+    UE_LOG(LogIGISDK, Display, TEXT("%s: baking %d lines with model %s"), ANSI_TO_TCHAR(__FUNCTION__), Lines->Num(), *GPT.GetModelGUID());
+
+    TMap<uint64, FString> Responses;
+    int32 NumFailed{ 0 };
+    for (int32 LineIndex = 0; LineIndex < Lines->Num(); ++LineIndex)
+    {
+        const TSharedPtr<FJsonObject> Line = (*Lines)[LineIndex]->AsObject();
+        if (!Line.IsValid() || !Line->HasField(TEXT("user")))
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("%s: line %d has no user prompt; skipped"), ANSI_TO_TCHAR(__FUNCTION__), LineIndex);
+            ++NumFailed;
+            continue;
+        }
+
+        FIGIGPTRequest Request;
+        FString Adapter;
+        Line->TryGetStringField(TEXT("system"), Request.SystemPrompt);
+        Line->TryGetStringField(TEXT("user"), Request.UserPrompt);
+        Line->TryGetStringField(TEXT("assistant"), Request.AssistantPrompt);
+        Line->TryGetStringField(TEXT("adapter"), Adapter);
+        Request.Adapter = Adapter.IsEmpty() ? NAME_None : FName(*Adapter);
+        Request.Seed = DefaultSeed;
+        Line->TryGetNumberField(TEXT("seed"), Request.Seed);
+
+        const uint64 Hash = FIGIBakedDialogue::HashRequest(Request);
+        if (Responses.Contains(Hash))
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("%s: line %d repeats the prompts of an earlier line; skipped"), ANSI_TO_TCHAR(__FUNCTION__), LineIndex);
+            continue;
+        }
+
+        FString Response = GPT.Evaluate(Request);
+        if (Response.IsEmpty())
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("%s: line %d generated nothing; it will run live"), ANSI_TO_TCHAR(__FUNCTION__), LineIndex);
+            ++NumFailed;
+            continue;
+        }
+
+        UE_LOG(LogIGISDK, Display, TEXT("%s: %d/%d"), ANSI_TO_TCHAR(__FUNCTION__), LineIndex + 1, Lines->Num());
+        Responses.Add(Hash, MoveTemp(Response));
+    }
+
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutputPath), true);
+    if (!FIGIBakedDialogue::Write(OutputPath, Responses))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to write %s"), ANSI_TO_TCHAR(__FUNCTION__), *OutputPath);
+        return 1;
+    }
+
+    UE_LOG(LogIGISDK, Display, TEXT("%s: wrote %d responses to %s, %d lines failed"), ANSI_TO_TCHAR(__FUNCTION__), Responses.Num(), *OutputPath, NumFailed);
+    return 0;
+}
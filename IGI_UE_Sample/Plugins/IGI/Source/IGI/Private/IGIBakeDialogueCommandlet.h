@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "IGIBakeDialogueCommandlet.generated.h"
+
+/**
+ * Generates the responses to a manifest of prompts ahead of time, with fixed seeds, into a dialogue bank that
+ * FIGIGPT::EvaluateAsync answers from without running the model. Meant to run before cooking:
+ *
+ *   UnrealEditor-Cmd <project> -run=IGIBakeDialogue -Manifest=<prompts.json> [-Output=<bank.igibake>] [-Seed=<seed>]
+ *
+ * The manifest is { "seed": 1, "lines": [ { "system": "", "user": "", "assistant": "", "adapter": "", "seed": 1 } ] },
+ * where only "user" is required. Banks go to Content/IGI by default, which the plugin stages with the game.
+ */
+UCLASS()
+class UIGIBakeDialogueCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UIGIBakeDialogueCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,167 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIBakedDialogue.h"
+
+#include "Algo/BinarySearch.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+
+#include "IGILog.h"
+
+namespace
+{
+    constexpr uint32 BAKE_MAGIC{ 0x42494749 }; // "IGIB"
+    constexpr uint32 BAKE_VERSION{ 1 };
+
+    struct FBakeHeader
+    {
+        uint32 Magic{ BAKE_MAGIC };
+        uint32 Version{ BAKE_VERSION };
+        uint32 NumEntries{ 0 };
+        uint32 Pad{ 0 };
+        uint64 TextSize{ 0 };
+    };
+    static_assert(sizeof(FBakeHeader) == 24, "The bank header is part of the file format");
+
+    void AppendUTF8(TArray<uint8>& Buffer, const FString& Text)
+    {
+        const auto TextUTF8 = StringCast<UTF8CHAR>(*Text);
+        Buffer.Append(reinterpret_cast<const uint8*>(TextUTF8.Get()), TextUTF8.Length());
+    }
+}
+
+struct FIGIBakedDialogue::FEntry
+{
+    uint64 Hash;
+    uint32 Offset;
+    uint32 Size;
+};
+
+FIGIBakedDialogue::~FIGIBakedDialogue()
+{
+    // The region must go before the handle it was mapped from
+    MappedRegion.Reset();
+    MappedHandle.Reset();
+}
+
+TUniquePtr<FIGIBakedDialogue> FIGIBakedDialogue::Open(const FString& Path)
+{
+    TUniquePtr<FIGIBakedDialogue> Bank(new FIGIBakedDialogue());
+
+    Bank->MappedHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+    if (Bank->MappedHandle.IsValid())
+    {
+        Bank->MappedRegion.Reset(Bank->MappedHandle->MapRegion(0, Bank->MappedHandle->GetFileSize(), false));
+    }
+
+    bool bBound{ false };
+    if (Bank->MappedRegion.IsValid())
+    {
+        bBound = Bank->Bind(Bank->MappedRegion->GetMappedPtr(), Bank->MappedRegion->GetMappedSize());
+    }
+    else if (FFileHelper::LoadFileToArray(Bank->LoadedData, *Path, FILEREAD_Silent))
+    {
+        bBound = Bank->Bind(Bank->LoadedData.GetData(), Bank->LoadedData.Num());
+    }
+
+    if (!bBound)
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: %s is not a dialogue bank of version %u"), ANSI_TO_TCHAR(__FUNCTION__), *Path, BAKE_VERSION);
+        return nullptr;
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: %s, %d responses"), ANSI_TO_TCHAR(__FUNCTION__), *Path, Bank->NumEntries);
+    return Bank;
+}
+
+bool FIGIBakedDialogue::Bind(const uint8* Data, int64 Size)
+{
+    static_assert(sizeof(FEntry) == 16, "Bank entries are part of the file format");
+
+    if (Size < static_cast<int64>(sizeof(FBakeHeader)))
+    {
+        return false;
+    }
+
+    FBakeHeader Header;
+    FMemory::Memcpy(&Header, Data, sizeof(FBakeHeader));
+
+    const int64 EntriesSize = static_cast<int64>(Header.NumEntries) * sizeof(FEntry);
+    if (Header.Magic != BAKE_MAGIC || Header.Version != BAKE_VERSION || static_cast<int64>(sizeof(FBakeHeader)) + EntriesSize + static_cast<int64>(Header.TextSize) > Size)
+    {
+        return false;
+    }
+
+    Entries = reinterpret_cast<const FEntry*>(Data + sizeof(FBakeHeader));
+    NumEntries = static_cast<int32>(Header.NumEntries);
+    Text = Data + sizeof(FBakeHeader) + EntriesSize;
+    TextSize = static_cast<int64>(Header.TextSize);
+    return true;
+}
+
+bool FIGIBakedDialogue::Write(const FString& Path, const TMap<uint64, FString>& Responses)
+{
+    TArray<uint64> Hashes;
+    Responses.GenerateKeyArray(Hashes);
+    Hashes.Sort();
+
+    TArray<FEntry> BankEntries;
+    TArray<uint8> BankText;
+    BankEntries.Reserve(Hashes.Num());
+    for (const uint64 Hash : Hashes)
+    {
+        const int32 Offset = BankText.Num();
+        AppendUTF8(BankText, Responses[Hash]);
+        BankEntries.Add({ Hash, static_cast<uint32>(Offset), static_cast<uint32>(BankText.Num() - Offset) });
+    }
+
+    FBakeHeader Header;
+    Header.NumEntries = static_cast<uint32>(BankEntries.Num());
+    Header.TextSize = static_cast<uint64>(BankText.Num());
+
+    TArray<uint8> Buffer;
+    Buffer.Append(reinterpret_cast<const uint8*>(&Header), sizeof(FBakeHeader));
+    Buffer.Append(reinterpret_cast<const uint8*>(BankEntries.GetData()), BankEntries.Num() * sizeof(FEntry));
+    Buffer.Append(BankText);
+
+    return FFileHelper::SaveArrayToFile(Buffer, *Path);
+}
+
+uint64 FIGIBakedDialogue::HashRequest(const FIGIGPTRequest& Request)
+{
+    // UTF-8 with separators, so that the key does not depend on TCHAR or on where one prompt ends and the next begins
+    TArray<uint8> Key;
+    for (const FString* Part : { &Request.SystemPrompt, &Request.UserPrompt, &Request.AssistantPrompt })
+    {
+        AppendUTF8(Key, *Part);
+        Key.Add(0);
+    }
+    if (!Request.Adapter.IsNone())
+    {
+        AppendUTF8(Key, Request.Adapter.ToString());
+    }
+
+    return CityHash64(reinterpret_cast<const char*>(Key.GetData()), static_cast<uint32>(Key.Num()));
+}
+
+bool FIGIBakedDialogue::Find(const FIGIGPTRequest& Request, FString& OutResponse) const
+{
+    const uint64 Hash = HashRequest(Request);
+    const int32 Index = Algo::LowerBoundBy(TConstArrayView<FEntry>(Entries, NumEntries), Hash, &FEntry::Hash);
+    if (Index >= NumEntries || Entries[Index].Hash != Hash)
+    {
+        return false;
+    }
+
+    const FEntry& Entry = Entries[Index];
+    if (static_cast<int64>(Entry.Offset) + Entry.Size > TextSize)
+    {
+        return false;
+    }
+
+    OutResponse = FString(static_cast<int32>(Entry.Size), reinterpret_cast<const UTF8CHAR*>(Text + Entry.Offset));
+    return true;
+}
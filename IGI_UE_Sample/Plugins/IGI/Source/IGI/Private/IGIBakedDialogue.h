@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/MappedFileHandle.h"
+
+#include "IGIGPT.h"
+
+/**
+ * Responses generated ahead of time by UIGIBakeDialogueCommandlet, keyed by a hash of the request's prompts and adapter.
+ * The file is a header, an array of entries sorted by hash and the UTF-8 text of the responses. It is memory mapped, so a
+ * bank costs nothing until lines are looked up, and a lookup is a binary search over the entries and one text conversion.
+ * Immutable once opened; lookups are thread safe.
+ */
+class FIGIBakedDialogue
+{
+public:
+    /** Extension of bank files, which are loaded from the IGI directory under the project content */
+    static constexpr const TCHAR* EXTENSION{ TEXT(".igibake") };
+
+    /** Opens a bank; null when the file is missing or not a bank of this version */
+    static TUniquePtr<FIGIBakedDialogue> Open(const FString& Path);
+
+    /** Writes a bank of Responses, keyed by HashRequest */
+    static bool Write(const FString& Path, const TMap<uint64, FString>& Responses);
+
+    /** Key of a request: its prompts and adapter. The seed is not part of it; a bank holds one response per prompt. */
+    static uint64 HashRequest(const FIGIGPTRequest& Request);
+
+    bool Find(const FIGIGPTRequest& Request, FString& OutResponse) const;
+
+    int32 Num() const { return NumEntries; }
+
+    ~FIGIBakedDialogue();
+
+private:
+    FIGIBakedDialogue() = default;
+
+    bool Bind(const uint8* Data, int64 Size);
+
+    TUniquePtr<IMappedFileHandle> MappedHandle;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+
+    // Where mapping is not available
+    TArray<uint8> LoadedData;
+
+    struct FEntry;
+    const FEntry* Entries{ nullptr };
+    int32 NumEntries{ 0 };
+    const uint8* Text{ nullptr };
+    int64 TextSize{ 0 };
+};
@@ -6,64 +6,277 @@
 
 #include "Async/Async.h"
 #include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
 #include "Modules/ModuleManager.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
 
 #include "IGIGPT.h"
 #include "IGILog.h"
+#include "IGIPregeneration.h"
 
-std::atomic<bool> UIGIGPTEvaluateAsync::IsRunning = false;
+namespace
+{
+    // Free nodes above this count are handed back to the garbage collector
+    constexpr int32 MAX_POOLED_NODES{ 64 };
+
+    TArray<UIGIGPTEvaluateAsync*> FreeNodes;
+    UIGIGPTEvaluateAsync::FPoolStats PoolStats;
+    FDelegateHandle PostGarbageCollectHandle;
+
+    // Cleared by EmptyPool, so that nodes released after it are not rooted again
+    bool bPooling{ true };
+}
 
 UIGIGPTEvaluateAsync* UIGIGPTEvaluateAsync::GPTEvaluateAsync(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt)
 {
-    if (IsRunning)
+    UIGIGPTEvaluateAsync* BlueprintNode = AcquireFromPool();
+    BlueprintNode->SystemPrompt = SystemPrompt;
+    BlueprintNode->UserPrompt = UserPrompt;
+    BlueprintNode->AssistantPrompt = AssistantPrompt;
+
+    return BlueprintNode;
+}
+
+UIGIGPTEvaluateAsync::FPoolStats UIGIGPTEvaluateAsync::GetPoolStats()
+{
+    check(IsInGameThread());
+
+    FPoolStats Stats{ PoolStats };
+    Stats.NumFree = FreeNodes.Num();
+    return Stats;
+}
+
+UIGIGPTEvaluateAsync* UIGIGPTEvaluateAsync::AcquireFromPool()
+{
+    check(IsInGameThread());
+
+    if (!PostGarbageCollectHandle.IsValid())
+    {
+        PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([]()
+            {
+                ++PoolStats.NumGarbageCollections;
+            });
+    }
+
+    bPooling = true;
+    ++PoolStats.NumRequests;
+
+    if (FreeNodes.Num() > 0)
     {
-        UE_LOG(LogIGISDK, Log, TEXT("%s: GPT is already running! Request was ignored."), ANSI_TO_TCHAR(__FUNCTION__));
-        return nullptr;
+        return FreeNodes.Pop(EAllowShrinking::No);
     }
 
+    // Pooled nodes are rooted once and stay rooted while they are in the pool
     UIGIGPTEvaluateAsync* BlueprintNode = NewObject<UIGIGPTEvaluateAsync>();
-    BlueprintNode->SystemPrompt = SystemPrompt;
-    BlueprintNode->UserPrompt = UserPrompt;
-    BlueprintNode->AssistantPrompt = AssistantPrompt;
     BlueprintNode->AddToRoot();
+    ++PoolStats.NumAllocations;
 
     return BlueprintNode;
 }
 
-void UIGIGPTEvaluateAsync::Activate()
+void UIGIGPTEvaluateAsync::ReleaseToPool()
 {
-    const FString TrimmedSystemPrompt = SystemPrompt.TrimStartAndEnd();
-    const FString TrimmedUserPrompt = UserPrompt.TrimStartAndEnd();
-    const FString TrimmedAssistantPrompt = AssistantPrompt.TrimStartAndEnd();
+    check(IsInGameThread());
+
+    ++PoolStats.NumReleases;
+
+    OnResponse.Clear();
+    SystemPrompt.Reset();
+    UserPrompt.Reset();
+    AssistantPrompt.Reset();
 
-    if (TrimmedUserPrompt.IsEmpty())
+    if (bPooling && FreeNodes.Num() < MAX_POOLED_NODES)
     {
-        UE_LOG(LogIGISDK, Log, TEXT("%s: GPT called with empty user prompt!"), ANSI_TO_TCHAR(__FUNCTION__));
+        FreeNodes.Push(this);
     }
     else
     {
-        IsRunning = true;
+        RemoveFromRoot();
+    }
+}
+
+void UIGIGPTEvaluateAsync::EmptyPool()
+{
+    check(IsInGameThread());
+
+    bPooling = false;
+    FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+    PostGarbageCollectHandle.Reset();
+
+    // The UObject system may already be gone at exit, and the nodes with it
+    if (UObjectInitialized())
+    {
+        for (UIGIGPTEvaluateAsync* Node : FreeNodes)
+        {
+            Node->RemoveFromRoot();
+        }
+    }
+    FreeNodes.Empty();
+}
 
-        UE_LOG(LogIGISDK, Log, TEXT("%s: sending to GPT: %s"), ANSI_TO_TCHAR(__FUNCTION__), *TrimmedUserPrompt);
+void UIGIGPTEvaluateAsync::StressPool(int32 NumRequests, int32 NumInFlight, int32 FramesPerGarbageCollection, TFunction<void(const FPoolStats&)>&& OnDone)
+{
+    check(IsInGameThread());
+
+    struct FStress
+    {
+        FPoolStats Before;
+        int32 NumIssued{ 0 };
+        int32 NumFrames{ 0 };
+        uint64 NumForcedGarbageCollections{ 0 };
+    };
+    TSharedRef<FStress> Stress = MakeShared<FStress>();
+    Stress->Before = GetPoolStats();
+
+    // Issued a frame at a time, as gameplay would, so that responses and garbage collections interleave with requests
+    FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+        [Stress, NumRequests, NumInFlight, FramesPerGarbageCollection, OnDone = MoveTemp(OnDone)](float /*DeltaTime*/)
+        {
+            const FPoolStats Current = GetPoolStats();
+            const int32 NumReleased = static_cast<int32>(Current.NumReleases - Stress->Before.NumReleases);
+
+            if (NumReleased >= NumRequests)
+            {
+                FPoolStats Delta = Current;
+                Delta.NumRequests -= Stress->Before.NumRequests;
+                Delta.NumReleases -= Stress->Before.NumReleases;
+                Delta.NumAllocations -= Stress->Before.NumAllocations;
+                Delta.NumGarbageCollections -= Stress->Before.NumGarbageCollections + Stress->NumForcedGarbageCollections;
+                OnDone(Delta);
+                return false;
+            }
 
-        AsyncTask(ENamedThreads::AnyBackgroundHiPriTask, [this, TrimmedSystemPrompt, TrimmedUserPrompt, TrimmedAssistantPrompt]()
+            const FString Prompt(TEXT("Greet the player who just walked into the tavern."));
+            while (Stress->NumIssued < NumRequests && Stress->NumIssued - NumReleased < NumInFlight)
             {
-                FString result;
-                FIGIGPT* GPT{ FModuleManager::GetModuleChecked<FIGIModule>(FName("IGI")).GetGPT()};
-                if (GPT != nullptr)
+                ++Stress->NumIssued;
+                GPTEvaluateAsync(FString(), Prompt, FString())->Activate();
+            }
+
+            // Pooled nodes, free or in flight, must come through unharmed
+            if (FramesPerGarbageCollection > 0 && ++Stress->NumFrames % FramesPerGarbageCollection == 0)
+            {
+                CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+                ++Stress->NumForcedGarbageCollections;
+            }
+            return true;
+        }));
+}
+
+void UIGIGPTEvaluateAsync::UpdateGPTDraft(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt)
+{
+    // Trimmed like the prompts of a request, so that the draft matches the request it becomes
+    FIGIGPTRequest Draft{ SystemPrompt.TrimStartAndEnd(), UserPrompt.TrimStartAndEnd(), AssistantPrompt.TrimStartAndEnd() };
+
+    // A keystroke is no reason to load the model
+    FIGIGPT* GPT{ FModuleManager::GetModuleChecked<FIGIModule>(FName("IGI")).FindGPT() };
+    if (GPT == nullptr)
+    {
+        return;
+    }
+
+    if (Draft.UserPrompt.IsEmpty())
+    {
+        GPT->ClearDraft();
+        return;
+    }
+
+    GPT->UpdateDraft(Draft);
+}
+
+void UIGIGPTEvaluateAsync::ClearGPTDraft()
+{
+    FIGIGPT* GPT{ FModuleManager::GetModuleChecked<FIGIModule>(FName("IGI")).FindGPT() };
+    if (GPT != nullptr)
+    {
+        GPT->ClearDraft();
+    }
+}
+
+void UIGIGPTEvaluateAsync::AnticipateGPTRequest(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt, float ExpirySeconds, int32 Priority)
+{
+    // Trimmed like the prompts of a request, so that the response serves the request it anticipates
+    FIGIGPTRequest Request{ SystemPrompt.TrimStartAndEnd(), UserPrompt.TrimStartAndEnd(), AssistantPrompt.TrimStartAndEnd() };
+    if (Request.UserPrompt.IsEmpty())
+    {
+        return;
+    }
+
+    FModuleManager::GetModuleChecked<FIGIModule>(FName("IGI")).GetPregeneration()->Anticipate(MoveTemp(Request), ExpirySeconds, Priority);
+}
+
+void UIGIGPTEvaluateAsync::Activate()
+{
+    SystemPrompt.TrimStartAndEndInline();
+    UserPrompt.TrimStartAndEndInline();
+    AssistantPrompt.TrimStartAndEndInline();
+
+    if (UserPrompt.IsEmpty())
+    {
+        UE_LOG(LogIGISDK, Log, TEXT("%s: GPT called with empty user prompt!"), ANSI_TO_TCHAR(__FUNCTION__));
+        ReleaseToPool();
+        return;
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: sending to GPT: %s"), ANSI_TO_TCHAR(__FUNCTION__), *UserPrompt);
+
+    // The node itself is rooted by the pool, so capturing it is safe
+    FModuleManager::GetModuleChecked<FIGIModule>(FName("IGI")).GetGPTAsync([this](FIGIGPT* GPT)
+        {
+            if (GPT == nullptr)
+            {
+                ReleaseToPool();
+                return;
+            }
+
+            // The prompt buffers are moved into the request
+            GPT->EvaluateAsync({ MoveTemp(SystemPrompt), MoveTemp(UserPrompt), MoveTemp(AssistantPrompt) }, [this](FString&& Response)
                 {
-                    result = GPT->Evaluate(TrimmedSystemPrompt, TrimmedUserPrompt, TrimmedAssistantPrompt);
+                    UE_LOG(LogIGISDK, Log, TEXT("%s: response from GPT: %s"), ANSI_TO_TCHAR(__FUNCTION__), *Response);
 
-                    AsyncTask(ENamedThreads::GameThread, [this, result]()
-                        {
-                            OnResponse.Broadcast(result);
-                        });
+                    OnResponse.Broadcast(Response);
+                    ReleaseToPool();
+                });
+        });
+}
 
-                    UE_LOG(LogIGISDK, Log, TEXT("%s: response from GPT: %s"), ANSI_TO_TCHAR(__FUNCTION__), *result);
-                }
+// ----------------------------------
 
-                IsRunning = false;
-                this->RemoveFromRoot();
-            });
+namespace
+{
+    void LogPoolStats(const UIGIGPTEvaluateAsync::FPoolStats& Stats, const TCHAR* Label)
+    {
+        const double NumRequests = FMath::Max<double>(1.0, static_cast<double>(Stats.NumRequests));
+        UE_LOG(LogIGISDK, Log, TEXT("%s: %llu requests, %llu node allocations (%.4f per request), %llu garbage collections (%.4f per request), %d free nodes"),
+            Label, Stats.NumRequests, Stats.NumAllocations, Stats.NumAllocations / NumRequests,
+            Stats.NumGarbageCollections, Stats.NumGarbageCollections / NumRequests, Stats.NumFree);
     }
+
+    FAutoConsoleCommand PoolStatsCommand(
+        TEXT("IGI.GPT.PoolStats"),
+        TEXT("Logs allocation and garbage collection counts of the pooled GPT Blueprint nodes."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                LogPoolStats(UIGIGPTEvaluateAsync::GetPoolStats(), TEXT("IGI.GPT.PoolStats"));
+            }));
+
+    FAutoConsoleCommand PoolStressCommand(
+        TEXT("IGI.GPT.PoolStress"),
+        TEXT("IGI.GPT.PoolStress <NumRequests> <NumInFlight> <FramesPerGC>: activates GPT Blueprint nodes across frames with forced garbage collections, then logs allocation counts. Run with -IGIGPTBackend=Synthetic to leave the model out."),
+        FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+            {
+                const int32 NumRequests = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000);
+                const int32 NumInFlight = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 16);
+                const int32 FramesPerGarbageCollection = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 10;
+
+                const int32 NumObjectsBefore = GUObjectArray.GetObjectArrayNumMinusAvailable();
+                UIGIGPTEvaluateAsync::StressPool(NumRequests, NumInFlight, FramesPerGarbageCollection, [NumObjectsBefore](const UIGIGPTEvaluateAsync::FPoolStats& Stats)
+                    {
+                        LogPoolStats(Stats, TEXT("IGI.GPT.PoolStress"));
+                        UE_LOG(LogIGISDK, Log, TEXT("IGI.GPT.PoolStress: live UObject count changed by %d"),
+                            GUObjectArray.GetObjectArrayNumMinusAvailable() - NumObjectsBefore);
+                    });
+            }));
 }
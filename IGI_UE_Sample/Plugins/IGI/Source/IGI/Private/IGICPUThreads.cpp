@@ -0,0 +1,356 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGICPUThreads.h"
+
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformAffinity.h"
+#include "HAL/ThreadManager.h"
+#include "Misc/ConfigCacheIni.h"
+
+#include "IGILog.h"
+#include "IGISettings.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <TlHelp32.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+namespace
+{
+    constexpr const TCHAR* const AUTOTUNE_CONFIG_SECTION{ TEXT("IGI.CPUThreads") };
+
+    // Doubling the thread count must gain at least this much to be worth the cores
+    constexpr float MIN_AUTOTUNE_GAIN{ 1.05f };
+
+    // Game, render and RHI threads, when the engine does not restrict them to cores of their own
+    constexpr int32 ENGINE_HOT_THREADS{ 3 };
+
+    // CPU time a new thread must have used by the first token to be one of the backend's workers, which all run the prefill
+    constexpr double MIN_BACKEND_THREAD_CPU_MS{ 1.0 };
+
+    // Frame time averaging, and frames between two changes of the target thread count
+    constexpr double FRAME_TIME_SMOOTHING{ 0.05 };
+    constexpr int32 FRAMES_BETWEEN_ADJUSTMENTS{ 30 };
+
+    // Narrow above this share of the frame budget, widen below the other
+    constexpr double NARROW_THRESHOLD{ 0.95 };
+    constexpr double WIDEN_THRESHOLD{ 0.75 };
+
+    int32 GetNumLogicalCores()
+    {
+        return FMath::Clamp(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), 1, 64);
+    }
+
+    uint64 GetAllCoresMask()
+    {
+        const int32 NumCores = GetNumLogicalCores();
+        return (NumCores >= 64) ? ~0ull : ((1ull << NumCores) - 1);
+    }
+
+    // Cores the engine's hot threads are restricted to; all cores when they are not restricted
+    uint64 GetEngineMask()
+    {
+        return (FPlatformAffinity::GetMainGameMask() | FPlatformAffinity::GetRenderingThreadMask() | FPlatformAffinity::GetRHIThreadMask()) & GetAllCoresMask();
+    }
+
+    TArray<uint32> GetProcessThreadIds()
+    {
+        TArray<uint32> ThreadIds;
+#if PLATFORM_WINDOWS
+        HANDLE Snapshot = ::CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (Snapshot != INVALID_HANDLE_VALUE)
+        {
+            const DWORD ProcessId = ::GetCurrentProcessId();
+            THREADENTRY32 Entry{};
+            Entry.dwSize = sizeof(Entry);
+            for (BOOL bMore = ::Thread32First(Snapshot, &Entry); bMore; bMore = ::Thread32Next(Snapshot, &Entry))
+            {
+                if (Entry.th32OwnerProcessID == ProcessId)
+                {
+                    ThreadIds.Add(Entry.th32ThreadID);
+                }
+            }
+            ::CloseHandle(Snapshot);
+        }
+#endif
+        return ThreadIds;
+    }
+
+    // User mode CPU time the thread used so far; 0 when unknown
+    double GetThreadCPUMilliseconds(uint32 ThreadId)
+    {
+        double Milliseconds{ 0.0 };
+#if PLATFORM_WINDOWS
+        HANDLE Thread = ::OpenThread(THREAD_QUERY_LIMITED_INFORMATION, 0, ThreadId);
+        if (Thread != nullptr)
+        {
+            FILETIME CreationTime, ExitTime, KernelTime, UserTime;
+            if (::GetThreadTimes(Thread, &CreationTime, &ExitTime, &KernelTime, &UserTime))
+            {
+                const uint64 Ticks = (static_cast<uint64>(UserTime.dwHighDateTime) << 32) | UserTime.dwLowDateTime;
+                Milliseconds = Ticks / 10000.0;
+            }
+            ::CloseHandle(Thread);
+        }
+#endif
+        return Milliseconds;
+    }
+
+    bool SetThreadAffinity(uint32 ThreadId, uint64 Mask)
+    {
+#if PLATFORM_WINDOWS
+        HANDLE Thread = ::OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, 0, ThreadId);
+        if (Thread != nullptr)
+        {
+            const bool bSet = ::SetThreadAffinityMask(Thread, static_cast<DWORD_PTR>(Mask)) != 0;
+            ::CloseHandle(Thread);
+            return bSet;
+        }
+#endif
+        return false;
+    }
+
+    FIGICPUThreadManager* ActiveManager{ nullptr };
+}
+
+FIGICPUThreadManager::FIGICPUThreadManager()
+{
+    ActiveManager = this;
+    TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FIGICPUThreadManager::Tick));
+}
+
+FIGICPUThreadManager::~FIGICPUThreadManager()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+    if (ActiveManager == this)
+    {
+        ActiveManager = nullptr;
+    }
+}
+
+int32 FIGICPUThreadManager::GetMaxThreads() const
+{
+    const uint64 EngineMask = GetEngineMask();
+    if (EngineMask != GetAllCoresMask())
+    {
+        return FMath::Max(1, GetNumLogicalCores() - FMath::CountBits(EngineMask));
+    }
+
+    const int32 LogicalPerPhysical = FMath::Max(1, GetNumLogicalCores() / FMath::Max(1, FPlatformMisc::NumberOfCores()));
+    return FMath::Max(1, GetNumLogicalCores() - ENGINE_HOT_THREADS * LogicalPerPhysical);
+}
+
+uint64 FIGICPUThreadManager::GetInferenceCoreMask(int32 NumCores) const
+{
+    // Highest cores first: the engine's threads start from the lowest ones
+    const uint64 EngineMask = GetEngineMask();
+    const uint64 Candidates = (EngineMask != GetAllCoresMask()) ? (GetAllCoresMask() & ~EngineMask) : GetAllCoresMask();
+
+    uint64 Mask{ 0 };
+    for (int32 Core = GetNumLogicalCores() - 1; Core >= 0 && NumCores > 0; --Core)
+    {
+        if (Candidates & (1ull << Core))
+        {
+            Mask |= 1ull << Core;
+            --NumCores;
+        }
+    }
+    return Mask;
+}
+
+int32 FIGICPUThreadManager::Autotune(const FString& CacheKey, TFunctionRef<float(int32 NumThreads)> MeasureTokensPerSecond)
+{
+    const FString ConfigKey = FString::Printf(TEXT("%08x"), GetTypeHash(CacheKey + FPlatformMisc::GetCPUBrand()));
+
+    int32 Best{ 0 };
+    if (GConfig->GetInt(AUTOTUNE_CONFIG_SECTION, *ConfigKey, Best, GGameUserSettingsIni) && Best > 0)
+    {
+        UE_LOG(LogIGISDK, Log, TEXT("%s: using %d threads from a previous run"), ANSI_TO_TCHAR(__FUNCTION__), Best);
+        return Best;
+    }
+
+    const int32 MaxThreads = GetMaxThreads();
+    float BestTokensPerSecond{ 0.0f };
+    for (int32 Candidate = 1; ; Candidate = FMath::Min(Candidate * 2, MaxThreads))
+    {
+        const float TokensPerSecond = MeasureTokensPerSecond(Candidate);
+        UE_LOG(LogIGISDK, Log, TEXT("%s: %d threads, %.1f tokens/s"), ANSI_TO_TCHAR(__FUNCTION__), Candidate, TokensPerSecond);
+
+        if (TokensPerSecond < BestTokensPerSecond * MIN_AUTOTUNE_GAIN)
+        {
+            break;
+        }
+        Best = Candidate;
+        BestTokensPerSecond = TokensPerSecond;
+
+        if (Candidate == MaxThreads)
+        {
+            break;
+        }
+    }
+
+    Best = FMath::Max(Best, 1);
+    GConfig->SetInt(AUTOTUNE_CONFIG_SECTION, *ConfigKey, Best, GGameUserSettingsIni);
+    GConfig->Flush(false, GGameUserSettingsIni);
+    return Best;
+}
+
+void FIGICPUThreadManager::BeginCaptureThreads()
+{
+    FScopeLock Lock(&CS);
+    ThreadsBeforeCapture = GetProcessThreadIds();
+}
+
+void FIGICPUThreadManager::EndCaptureThreads(int32 InNumThreads)
+{
+    FScopeLock Lock(&CS);
+
+    NumThreads = InNumThreads;
+    BackendThreads.Reset();
+
+    // Threads the engine created itself are not the backend's
+    TSet<uint32> EngineThreads;
+    FThreadManager::Get().ForEachThread([&EngineThreads](uint32 ThreadId, FRunnableThread*)
+        {
+            EngineThreads.Add(ThreadId);
+        });
+
+    // Drivers and nvigi start threads of their own on first use too, but those mostly wait; ggml's workers all ran the prefill
+    TArray<TPair<double, uint32>> Candidates;
+    for (const uint32 ThreadId : GetProcessThreadIds())
+    {
+        if (!ThreadsBeforeCapture.Contains(ThreadId) && !EngineThreads.Contains(ThreadId))
+        {
+            const double CPUMilliseconds = GetThreadCPUMilliseconds(ThreadId);
+            if (CPUMilliseconds >= MIN_BACKEND_THREAD_CPU_MS)
+            {
+                Candidates.Add({ CPUMilliseconds, ThreadId });
+            }
+        }
+    }
+    Candidates.Sort([](const TPair<double, uint32>& A, const TPair<double, uint32>& B) { return A.Key > B.Key; });
+    for (int32 Index = 0; Index < FMath::Min(Candidates.Num(), NumThreads); ++Index)
+    {
+        BackendThreads.Add(Candidates[Index].Value);
+    }
+    ThreadsBeforeCapture.Reset();
+
+    if (!GetDefault<UIGISettings>()->bPinCPUInferenceThreads)
+    {
+        BackendThreads.Reset();
+    }
+    else if (BackendThreads.Num() == 0)
+    {
+        UE_LOG(LogIGISDK, Log, TEXT("%s: the backend does not keep persistent threads; they cannot be pinned"), ANSI_TO_TCHAR(__FUNCTION__));
+    }
+
+    ApplyAffinity();
+}
+
+void FIGICPUThreadManager::SetTunedThreads(int32 InNumTunedThreads)
+{
+    FScopeLock Lock(&CS);
+    NumTunedThreads = InNumTunedThreads;
+    NumTargetThreads = InNumTunedThreads;
+}
+
+int32 FIGICPUThreadManager::GetTargetThreads() const
+{
+    FScopeLock Lock(&CS);
+    return NumTargetThreads;
+}
+
+void FIGICPUThreadManager::ApplyAffinity()
+{
+    // One core per thread: ggml waits for every chunk of an op before the next, so a thread sharing a core stalls them all
+    const uint64 Mask = GetInferenceCoreMask(NumThreads);
+    BackendThreads.RemoveAll([Mask](uint32 ThreadId)
+        {
+            // Threads that exited since the capture drop out here
+            return !SetThreadAffinity(ThreadId, Mask);
+        });
+}
+
+void FIGICPUThreadManager::OnRequestStarted()
+{
+    ++NumRequestsInFlight;
+}
+
+void FIGICPUThreadManager::OnRequestFinished(int32 NumTokens, double Seconds)
+{
+    --NumRequestsInFlight;
+
+    FScopeLock Lock(&CS);
+    TotalTokens += NumTokens;
+    TotalSeconds += Seconds;
+}
+
+bool FIGICPUThreadManager::Tick(float /*DeltaTime*/)
+{
+    // Whichever of the game and render threads is the bottleneck
+    const double FrameMs = FMath::Max(FPlatformTime::ToMilliseconds(GGameThreadTime), FPlatformTime::ToMilliseconds(GRenderThreadTime));
+    const bool bInferring = NumRequestsInFlight.load() > 0;
+
+    FScopeLock Lock(&CS);
+
+    double& AverageMs = bInferring ? FrameMsInferring : FrameMsIdle;
+    AverageMs = (AverageMs == 0.0) ? FrameMs : FMath::Lerp(AverageMs, FrameMs, FRAME_TIME_SMOOTHING);
+
+    const UIGISettings* Settings = GetDefault<UIGISettings>();
+    if (!bInferring || !Settings->bAdaptCPUThreadsToGameLoad || NumTunedThreads == 0 || ++FramesSinceAdjustment < FRAMES_BETWEEN_ADJUSTMENTS)
+    {
+        return true;
+    }
+    FramesSinceAdjustment = 0;
+
+    const double BudgetMs = Settings->CPUFrameBudgetMs;
+    if (FrameMsInferring > BudgetMs * NARROW_THRESHOLD && NumTargetThreads > 1)
+    {
+        --NumTargetThreads;
+    }
+    else if (FrameMsInferring < BudgetMs * WIDEN_THRESHOLD && NumTargetThreads < NumTunedThreads)
+    {
+        ++NumTargetThreads;
+    }
+
+    return true;
+}
+
+FIGICPUThreadManager::FStats FIGICPUThreadManager::GetStats() const
+{
+    FScopeLock Lock(&CS);
+
+    FStats Stats;
+    Stats.NumThreads = NumThreads;
+    Stats.NumTargetThreads = NumTargetThreads;
+    Stats.NumPinnedThreads = BackendThreads.Num();
+    Stats.TokensPerSecond = (TotalSeconds > 0.0) ? TotalTokens / TotalSeconds : 0.0;
+    Stats.FrameMsIdle = FrameMsIdle;
+    Stats.FrameMsInferring = FrameMsInferring;
+    return Stats;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand CPUStatsCommand(
+        TEXT("IGI.GPT.CPUStats"),
+        TEXT("Prints the CPU inference backend's threads, throughput and the game frame time with and without inference running."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                if (ActiveManager == nullptr)
+                {
+                    UE_LOG(LogIGISDK, Log, TEXT("IGI.GPT.CPUStats: the GPT does not run on the CPU backend"));
+                    return;
+                }
+
+                const FIGICPUThreadManager::FStats Stats = ActiveManager->GetStats();
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.GPT.CPUStats: %d threads, %d pinned, %d targeted; %.1f tokens/s; frame %.2f ms idle, %.2f ms while inferring"),
+                    Stats.NumThreads, Stats.NumPinnedThreads, Stats.NumTargetThreads, Stats.TokensPerSecond, Stats.FrameMsIdle, Stats.FrameMsInferring);
+            }));
+}
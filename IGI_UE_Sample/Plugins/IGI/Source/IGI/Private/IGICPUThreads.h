@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+#include <atomic>
+
+/**
+ * Thread placement of the CPU inference backend. ggml runs its own worker threads, so the manager:
+ * - picks a thread count by benchmarking a few counts once per machine and model, cached in the user settings;
+ * - pins the backend's threads to as many of the highest cores outside the engine's game, render and RHI thread masks
+ *   (FPlatformAffinity); they are the busiest threads that appeared during the instance's first evaluation (Windows only);
+ * - while inference runs, lowers or raises a target thread count as the game and render thread times approach or leave
+ *   the frame budget. ggml splits each op into one chunk per thread behind a barrier, so fewer cores than threads would
+ *   stall every op; the GPT recreates its instance with the target count between requests instead (GetTargetThreads);
+ * - reports tokens per second and game frame times with and without inference running (IGI.GPT.CPUStats).
+ */
+class FIGICPUThreadManager
+{
+public:
+    FIGICPUThreadManager();
+    ~FIGICPUThreadManager();
+
+    /** Largest thread count worth trying: the logical cores the engine's hot threads do not claim */
+    int32 GetMaxThreads() const;
+
+    /**
+     * Thread count for CacheKey, benchmarked with MeasureTokensPerSecond on the first run on this machine.
+     * Counts are doubled until the gain falls below a few percent.
+     */
+    int32 Autotune(const FString& CacheKey, TFunctionRef<float(int32 NumThreads)> MeasureTokensPerSecond);
+
+    /** Snapshot of the process' threads, taken before the instance evaluates for the first time */
+    void BeginCaptureThreads();
+
+    /**
+     * The NumThreads busiest threads that appeared since BeginCaptureThreads and ran for a while are the backend's; pins
+     * them to NumThreads inference cores. Threads the engine created, and idle ones such as the driver's, are left alone.
+     */
+    void EndCaptureThreads(int32 NumThreads);
+
+    /** Thread count the autotune or the settings chose; GetTargetThreads never goes above it */
+    void SetTunedThreads(int32 InNumTunedThreads);
+
+    /** Thread count the backend should run with under the current game load, between 1 and the tuned count */
+    int32 GetTargetThreads() const;
+
+    /** Called by the GPT around each request, to attribute frame times and report throughput */
+    void OnRequestStarted();
+    void OnRequestFinished(int32 NumTokens, double Seconds);
+
+    struct FStats
+    {
+        int32 NumThreads{ 0 };
+        int32 NumTargetThreads{ 0 };
+        int32 NumPinnedThreads{ 0 };
+        double TokensPerSecond{ 0.0 };
+        double FrameMsIdle{ 0.0 };
+        double FrameMsInferring{ 0.0 };
+    };
+    FStats GetStats() const;
+
+private:
+    bool Tick(float DeltaTime);
+    uint64 GetInferenceCoreMask(int32 NumCores) const;
+    void ApplyAffinity();
+
+    mutable FCriticalSection CS;
+    TArray<uint32> ThreadsBeforeCapture;
+    TArray<uint32> BackendThreads;
+    int32 NumThreads{ 0 };
+    int32 NumTunedThreads{ 0 };
+    int32 NumTargetThreads{ 0 };
+    int32 FramesSinceAdjustment{ 0 };
+
+    std::atomic<int32> NumRequestsInFlight{ 0 };
+    int64 TotalTokens{ 0 };
+    double TotalSeconds{ 0.0 };
+    double FrameMsIdle{ 0.0 };
+    double FrameMsInferring{ 0.0 };
+
+    FTSTicker::FDelegateHandle TickHandle;
+};
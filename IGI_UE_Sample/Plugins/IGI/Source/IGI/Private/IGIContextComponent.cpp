@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIContextComponent.h"
+
+#include "HAL/IConsoleManager.h"
+
+#include "IGILog.h"
+
+UIGIContextComponent::UIGIContextComponent()
+{
+    PrimaryComponentTick.bCanEverTick = false;
+}
+
+UIGIContextComponent::FCategory* UIGIContextComponent::FindCategory(FName Category)
+{
+    return Categories.FindByPredicate([Category](const FCategory& Candidate) { return Candidate.Name == Category; });
+}
+
+void UIGIContextComponent::SetField(FName Category, FName Key, const FString& Value)
+{
+    FCategory* Found = FindCategory(Category);
+    if (Found == nullptr)
+    {
+        Found = &Categories.AddDefaulted_GetRef();
+        Found->Name = Category;
+    }
+
+    FField* Field = Found->Fields.FindByPredicate([Key](const FField& Candidate) { return Candidate.Key == Key; });
+    if (Field == nullptr)
+    {
+        Found->Fields.Add({ Key, Value });
+    }
+    else if (!Field->Value.Equals(Value, ESearchCase::CaseSensitive))
+    {
+        Field->Value = Value;
+    }
+    else
+    {
+        return;
+    }
+
+    Found->bDirty = true;
+    bDirty = true;
+}
+
+void UIGIContextComponent::SetIntField(FName Category, FName Key, int32 Value)
+{
+    SetField(Category, Key, FString::FromInt(Value));
+}
+
+void UIGIContextComponent::SetFloatField(FName Category, FName Key, float Value, int32 Precision)
+{
+    SetField(Category, Key, FString::Printf(TEXT("%.*f"), FMath::Clamp(Precision, 0, 6), Value));
+}
+
+void UIGIContextComponent::RemoveField(FName Category, FName Key)
+{
+    if (FCategory* Found = FindCategory(Category))
+    {
+        if (Found->Fields.RemoveAll([Key](const FField& Candidate) { return Candidate.Key == Key; }) > 0)
+        {
+            Found->bDirty = true;
+            bDirty = true;
+        }
+    }
+}
+
+void UIGIContextComponent::RemoveCategory(FName Category)
+{
+    if (Categories.RemoveAll([Category](const FCategory& Candidate) { return Candidate.Name == Category; }) > 0)
+    {
+        bDirty = true;
+    }
+}
+
+const FString& UIGIContextComponent::BuildContext()
+{
+    if (!bDirty)
+    {
+        return Context;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+
+    int32 ContextLength{ 0 };
+    for (FCategory& Category : Categories)
+    {
+        if (Category.bDirty)
+        {
+            // "Category: key=value, key=value"
+            Category.Fragment.Reset();
+            if (Category.Fields.Num() > 0)
+            {
+                Category.Fragment += Category.Name.ToString();
+                Category.Fragment += TEXT(":");
+                for (int32 Index = 0; Index < Category.Fields.Num(); ++Index)
+                {
+                    const FField& Field = Category.Fields[Index];
+                    Category.Fragment += (Index == 0) ? TEXT(" ") : TEXT(", ");
+                    Field.Key.AppendString(Category.Fragment);
+                    Category.Fragment += TEXT("=");
+                    Category.Fragment += Field.Value;
+                }
+            }
+
+            Category.bDirty = false;
+            ++Stats.NumFragmentsSerialized;
+        }
+
+        ContextLength += Category.Fragment.Len() + 1;
+    }
+
+    // Reuses the previous allocation; clean fragments are only copied
+    Context.Reset(ContextLength);
+    for (const FCategory& Category : Categories)
+    {
+        if (!Category.Fragment.IsEmpty())
+        {
+            if (!Context.IsEmpty())
+            {
+                Context += TEXT("\n");
+            }
+            Context += Category.Fragment;
+        }
+    }
+
+    bDirty = false;
+    ++Stats.NumBuilds;
+    Stats.LastBuildMicroseconds = (FPlatformTime::Seconds() - StartTime) * 1e6;
+
+    return Context;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand ContextBenchCommand(
+        TEXT("IGI.Context.Bench"),
+        TEXT("IGI.Context.Bench <NumCategories> <NumFieldsPerCategory> <NumBuilds>: changes one field per build and compares incremental context builds with re-describing the whole state in prose."),
+        FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+            {
+                const int32 NumCategories = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8);
+                const int32 NumFields = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 8);
+                const int32 NumBuilds = FMath::Max(1, Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 10000);
+
+                UIGIContextComponent* ContextComponent = NewObject<UIGIContextComponent>();
+
+                TArray<FName> CategoryNames;
+                TArray<FName> KeyNames;
+                for (int32 Category = 0; Category < NumCategories; ++Category)
+                {
+                    CategoryNames.Add(FName(FString::Printf(TEXT("Category%d"), Category)));
+                }
+                for (int32 Field = 0; Field < NumFields; ++Field)
+                {
+                    KeyNames.Add(FName(FString::Printf(TEXT("field%d"), Field)));
+                }
+
+                TArray<int32> Values;
+                Values.SetNumZeroed(NumCategories * NumFields);
+                for (int32 Category = 0; Category < NumCategories; ++Category)
+                {
+                    for (int32 Field = 0; Field < NumFields; ++Field)
+                    {
+                        ContextComponent->SetIntField(CategoryNames[Category], KeyNames[Field], 0);
+                    }
+                }
+                ContextComponent->BuildContext();
+
+                // What the gameplay code used to do: describe everything again for every request
+                auto DescribeInProse = [&]()
+                    {
+                        FString Description;
+                        for (int32 Category = 0; Category < NumCategories; ++Category)
+                        {
+                            for (int32 Field = 0; Field < NumFields; ++Field)
+                            {
+                                Description += FString::Printf(TEXT("The %s of %s is currently %d. "), *KeyNames[Field].ToString(),
+                                    *CategoryNames[Category].ToString(), Values[Category * NumFields + Field]);
+                            }
+                        }
+                        return Description;
+                    };
+
+                double IncrementalSeconds{ 0.0 };
+                double ProseSeconds{ 0.0 };
+                int32 ContextLength{ 0 };
+                int32 ProseLength{ 0 };
+
+                for (int32 Build = 0; Build < NumBuilds; ++Build)
+                {
+                    const int32 Changed = Build % Values.Num();
+                    ++Values[Changed];
+
+                    double StartTime = FPlatformTime::Seconds();
+                    ContextComponent->SetIntField(CategoryNames[Changed / NumFields], KeyNames[Changed % NumFields], Values[Changed]);
+                    ContextLength = ContextComponent->BuildContext().Len();
+                    IncrementalSeconds += FPlatformTime::Seconds() - StartTime;
+
+                    StartTime = FPlatformTime::Seconds();
+                    ProseLength = DescribeInProse().Len();
+                    ProseSeconds += FPlatformTime::Seconds() - StartTime;
+                }
+
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.Context.Bench: %d fields, %d builds: incremental %.2f us per build, %d chars; prose %.2f us per build, %d chars; %llu fragments serialized"),
+                    NumCategories * NumFields, NumBuilds, IncrementalSeconds * 1e6 / NumBuilds, ContextLength, ProseSeconds * 1e6 / NumBuilds, ProseLength,
+                    ContextComponent->GetStats().NumFragmentsSerialized);
+            }));
+}
@@ -9,7 +9,10 @@
 #include "HAL/PlatformProcess.h"
 #include "Interfaces/IPluginManager.h"
 
+#include "IGIAdapterSelection.h"
 #include "IGILog.h"
+#include "IGIPlatformRHI.h"
+#include "IGISettings.h"
 
 #include "nvigi.h"
 #include "nvigi_ai.h"
@@ -24,6 +27,49 @@
 #include "nvigi_types.h"
 #endif
 
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <dxgi1_4.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+namespace
+{
+    // Whether the engine renders on this adapter; adapters can only be matched by LUID on D3D12
+    bool IsRenderAdapter(const nvigi::AdapterSpec* Adapter, bool& bOutKnown)
+    {
+#if PLATFORM_WINDOWS
+        if (GDynamicRHI && GDynamicRHI->GetInterfaceType() == ERHIInterfaceType::D3D12)
+        {
+            ID3D12Device* D3D12Device = GetID3D12DynamicRHI()->RHIGetDevice(0);
+            if (D3D12Device != nullptr)
+            {
+                bOutKnown = true;
+                const LUID RenderAdapterLuid = D3D12Device->GetAdapterLuid();
+                return IsSameIGIAdapterLuid(RenderAdapterLuid, Adapter->id);
+            }
+        }
+#endif
+        bOutKnown = false;
+        return false;
+    }
+
+    EIGIAdapterSelection ToAdapterSelection(EIGIAdapterPolicy Policy)
+    {
+        switch (Policy)
+        {
+        case EIGIAdapterPolicy::MostVideoMemory:
+            return EIGIAdapterSelection::MostVideoMemory;
+        case EIGIAdapterPolicy::PreferredVendor:
+            return EIGIAdapterSelection::PreferredVendor;
+        case EIGIAdapterPolicy::AdapterIndex:
+            return EIGIAdapterSelection::AdapterIndex;
+        default:
+            return EIGIAdapterSelection::HighestArchitecture;
+        }
+    }
+}
+
 FIGICore::FIGICore(FString IGICoreLibraryPath)
 {
     IGICoreLibraryHandle = !IGICoreLibraryPath.IsEmpty() ? FPlatformProcess::GetDllHandle(*IGICoreLibraryPath) : nullptr;
@@ -73,23 +119,64 @@ FIGICore::FIGICore(FString IGICoreLibraryPath)
     nvigi::Result InitResult = (*Ptr_nvigiInit)(Pref, &IGIRequirements, nvigi::kSDKVersion);
 
     // Find HW Adapter
-    uint32_t HWAdapter = 0;
+    bool bRenderAdapterKnown{ false };
+    TArray<FIGIAdapterInfo> Adapters;
     for (int i = 0; i < IGIRequirements->numDetectedAdapters; i++)
     {
         const auto& Adapter = IGIRequirements->detectedAdapters[i];
-        if (IsPhysicalVendor(Adapter) && HWAdapter < Adapter->architecture)
+
+        FIGIAdapterInfo& Info = Adapters.AddDefaulted_GetRef();
+        Info.Vendor = static_cast<uint32>(Adapter->vendor);
+        Info.Architecture = Adapter->architecture;
+        Info.DedicatedMemoryMB = Adapter->dedicatedMemoryInMB;
+        Info.bIsPhysical = IsPhysicalVendor(Adapter);
+        Info.bIsRenderAdapter = IsRenderAdapter(Adapter, bRenderAdapterKnown);
+
+        UE_LOG(LogIGISDK, Log, TEXT("IGI: Found adapter %d: vendor: 0x%X ; architecture: %u ; VRAM: %llu MB%s"), i, Info.Vendor, Info.Architecture,
+            Info.DedicatedMemoryMB, Info.bIsRenderAdapter ? TEXT(" ; render adapter") : TEXT(""));
+    }
+
+    const UIGISettings* Settings = GetDefault<UIGISettings>();
+    if (Settings->bAvoidRenderAdapter && !bRenderAdapterKnown)
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("IGI: The render adapter can only be identified on D3D12; bAvoidRenderAdapter is ignored"));
+    }
+
+    FIGIAdapterSelectionPolicy Policy;
+    Policy.Policy = ToAdapterSelection(Settings->AdapterPolicy);
+    Policy.PreferredVendorId = static_cast<uint32>(Settings->PreferredVendorId);
+    Policy.AdapterIndex = Settings->AdapterIndex;
+    Policy.bAvoidRenderAdapter = Settings->bAvoidRenderAdapter;
+
+    AdapterId = SelectIGIAdapter(Adapters, Policy);
+
+    // Without D3D12 the render adapter is unknown and nvigi is handed the engine's Vulkan device, whatever the policy picked
+    const int32 RenderAdapterId = Adapters.IndexOfByPredicate([](const FIGIAdapterInfo& Adapter) { return Adapter.bIsRenderAdapter; });
+    if (!bRenderAdapterKnown && Adapters.Num() > 1 && (Settings->AdapterPolicy != EIGIAdapterPolicy::HighestArchitecture || Settings->bAvoidRenderAdapter))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("IGI: AdapterPolicy and bAvoidRenderAdapter need the D3D12 RHI; inference runs on the adapter the engine renders on"));
+    }
+
+    if (AdapterId >= 0)
+    {
+        bInferenceOnRenderAdapter = !bRenderAdapterKnown || Adapters[AdapterId].bIsRenderAdapter;
+
+#if PLATFORM_WINDOWS
+        if (!bInferenceOnRenderAdapter && !CreateInferenceAdapterDevice())
         {
-            UE_LOG(LogIGISDK, Log, TEXT("IGI: Found adapter %d: vendor: 0x%X ; architecture: %u"), i, Adapter->vendor, Adapter->architecture);
-            HWAdapter = Adapter->architecture;
-            AdapterId = i;
+            UE_LOG(LogIGISDK, Error, TEXT("IGI: Unable to create a D3D12 device on adapter %d, so inference cannot run there; using the render adapter %d"),
+                AdapterId, RenderAdapterId);
+            AdapterId = RenderAdapterId;
+            bInferenceOnRenderAdapter = true;
         }
+#endif
+
+        UE_LOG(LogIGISDK, Log, TEXT("IGI: Selected adapter %d%s"), AdapterId, bInferenceOnRenderAdapter ? TEXT("") : TEXT(", which the engine does not render on"));
     }
 
-    if (AdapterId < 0)
+    if (AdapterId < 0 || !Adapters[AdapterId].bIsPhysical)
     {
         UE_LOG(LogIGISDK, Warning, TEXT("No hardware adapters found.  GPU plugins will not be available"));
-        if (IGIRequirements->numDetectedAdapters)
-            AdapterId = 0;
     }
     
     UE_LOG(LogIGISDK, Log, TEXT("IGI: Init result: %u"), InitResult);
@@ -99,11 +186,93 @@ FIGICore::FIGICore(FString IGICoreLibraryPath)
 
 FIGICore::~FIGICore()
 {
+#if PLATFORM_WINDOWS
+    InferenceQueue.SafeRelease();
+    InferenceDevice.SafeRelease();
+#endif
+
     // Free the dll handle
     FPlatformProcess::FreeDllHandle(IGICoreLibraryHandle);
     IGICoreLibraryHandle = nullptr;
 }
 
+#if PLATFORM_WINDOWS
+bool FIGICore::CreateInferenceAdapterDevice()
+{
+    const nvigi::AdapterSpec* Adapter = IGIRequirements->detectedAdapters[AdapterId];
+
+    TRefCountPtr<IDXGIFactory4> Factory;
+    if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(Factory.GetInitReference()))))
+    {
+        return false;
+    }
+
+    LUID AdapterLuid;
+    AdapterLuid.LowPart = Adapter->id.LowPart;
+    AdapterLuid.HighPart = Adapter->id.HighPart;
+
+    TRefCountPtr<IDXGIAdapter> DXGIAdapter;
+    if (FAILED(Factory->EnumAdapterByLuid(AdapterLuid, IID_PPV_ARGS(DXGIAdapter.GetInitReference())))
+        || FAILED(D3D12CreateDevice(DXGIAdapter.GetReference(), D3D_FEATURE_LEVEL_12_0, IID_PPV_ARGS(InferenceDevice.GetInitReference()))))
+    {
+        return false;
+    }
+
+    D3D12_COMMAND_QUEUE_DESC QueueDesc{};
+    QueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+    QueueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+    QueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    QueueDesc.NodeMask = 0u;
+    if (FAILED(InferenceDevice->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(InferenceQueue.GetInitReference()))))
+    {
+        InferenceDevice.SafeRelease();
+        return false;
+    }
+
+    InferenceDevice->SetName(TEXT("IGI Inference Device"));
+    InferenceQueue->SetName(TEXT("IGI Inference Queue"));
+    return true;
+}
+
+nvigi::D3D12Parameters FIGICore::GetInferenceAdapterD3D12Parameters() const
+{
+    nvigi::D3D12Parameters Parameters;
+    Parameters.device = InferenceDevice.GetReference();
+    Parameters.queue = InferenceQueue.GetReference();
+    return Parameters;
+}
+#endif
+
+uint64 FIGICore::GetInferenceAdapterFreeMemoryMB() const
+{
+    const nvigi::AdapterSpec* Adapter = (AdapterId >= 0) ? IGIRequirements->detectedAdapters[AdapterId] : nullptr;
+    if (Adapter == nullptr)
+    {
+        return 0;
+    }
+
+#if PLATFORM_WINDOWS
+    // The OS budget accounts for what other processes, including the engine's own device, already use
+    TRefCountPtr<IDXGIFactory4> Factory;
+    if (SUCCEEDED(CreateDXGIFactory1(IID_PPV_ARGS(Factory.GetInitReference()))))
+    {
+        LUID AdapterLuid;
+        AdapterLuid.LowPart = Adapter->id.LowPart;
+        AdapterLuid.HighPart = Adapter->id.HighPart;
+
+        TRefCountPtr<IDXGIAdapter3> DXGIAdapter;
+        DXGI_QUERY_VIDEO_MEMORY_INFO MemoryInfo{};
+        if (SUCCEEDED(Factory->EnumAdapterByLuid(AdapterLuid, IID_PPV_ARGS(DXGIAdapter.GetInitReference())))
+            && SUCCEEDED(DXGIAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &MemoryInfo)))
+        {
+            return (MemoryInfo.Budget > MemoryInfo.CurrentUsage) ? (MemoryInfo.Budget - MemoryInfo.CurrentUsage) / (1024 * 1024) : 0;
+        }
+    }
+#endif
+
+    return Adapter->dedicatedMemoryInMB;
+}
+
 nvigi::Result FIGICore::LoadInterface(const nvigi::PluginID& Feature, const nvigi::UID& InterfaceType, nvigi::InferenceInterface** Interface, const UTF8CHAR* UTF8PathToPlugin)
 {
     if (Ptr_nvigiLoadInterface == nullptr)
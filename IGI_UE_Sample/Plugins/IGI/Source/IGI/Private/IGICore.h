@@ -5,7 +5,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+#include "IGIAdapterSelection.h"
 #include "IGILog.h"
+#include "IGIPlatformRHI.h"
 
 #include "nvigi.h"
 #include "nvigi_ai.h"
@@ -19,13 +22,27 @@ public:
 
     bool IsInitialized() const { return bInitialized; }
 
+    /** Whether the selected inference adapter is the one the engine renders on, so that it can share the render device */
+    bool IsInferenceOnRenderAdapter() const { return bInferenceOnRenderAdapter; }
+
+#if PLATFORM_WINDOWS
+    /**
+     * D3D12 device and compute queue created on the inference adapter when the engine does not render on it; empty
+     * otherwise. nvigi creates its CUDA context on the adapter of the D3D12 device it is given.
+     */
+    nvigi::D3D12Parameters GetInferenceAdapterD3D12Parameters() const;
+#endif
+
+    /** Video memory this process can still use on the inference adapter, in MB; the adapter's dedicated memory where the OS budget is unknown */
+    uint64 GetInferenceAdapterFreeMemoryMB() const;
+
     nvigi::Result LoadInterface(const nvigi::PluginID& Feature, const nvigi::UID& InterfaceType, nvigi::InferenceInterface** Interface, const UTF8CHAR* UTF8PathToPlugin = nullptr);
     nvigi::Result UnloadInterface(const nvigi::PluginID& Feature, nvigi::InferenceInterface* Interface);
     nvigi::Result CheckPluginCompatibility(const nvigi::PluginID& Feature, const FString& Name);
 
     static bool IsPhysicalVendor(const nvigi::AdapterSpec* Adapter)
     {
-        const bool bIsPhysicalVendor = Adapter->vendor != nvigi::VendorId::eAny || Adapter->vendor != nvigi::VendorId::eNone;
+        const bool bIsPhysicalVendor = IsPhysicalIGIAdapterVendor(Adapter->vendor);
         UE_LOG(LogIGISDK, Log, TEXT("IGI: %s adapter vendor: 0x%X id"), bIsPhysicalVendor ? TEXT("Physical") : TEXT("Not physical"), Adapter->vendor);
         
         return bIsPhysicalVendor;
@@ -46,4 +63,13 @@ private:
     bool bInitialized{ false };
 
     int AdapterId = -1;
+    bool bInferenceOnRenderAdapter{ true };
+
+#if PLATFORM_WINDOWS
+    // Only when inference runs on another adapter than the engine's
+    bool CreateInferenceAdapterDevice();
+
+    TRefCountPtr<ID3D12Device> InferenceDevice;
+    TRefCountPtr<ID3D12CommandQueue> InferenceQueue;
+#endif
 };
@@ -4,20 +4,54 @@
 
 #include "IGIGPT.h"
 
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+
+#include "IGICPUThreads.h"
+#include "IGIGPTTrace.h"
 #include "IGIPlatformRHI.h"
+#include "IGILoRAAdapters.h"
 #include "IGIMinimal.h"
+#include "IGIModelVariants.h"
+#include "IGIPregeneration.h"
+#include "IGISettings.h"
+#include "IGISyntheticGPT.h"
 
 #include "nvigi_gpt.h"
 
 #include <condition_variable>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace
 {
     constexpr const char* const GGUF_MODEL_MINITRON{ "{01F43B70-CE23-42CA-9606-74E80C5ED0B6}" };
-    constexpr std::size_t VRAM_BUDGET_RECOMMENDATION{ 1024 * 8 };
-    constexpr std::size_t THREAD_NUM_RECOMMENDATION{ 1 }; // Recommended number of threads for CiG
+    constexpr int32 THREAD_NUM_RECOMMENDATION{ 1 }; // Recommended number of threads for CiG
     constexpr std::size_t CONTEXT_SIZE_RECOMMENDATION{ 4096 };
+    constexpr int32 TOKENS_TO_PREDICT{ 200 };
+
+    // Average number of characters per token for English text with the Nemotron/Llama vocabularies
+    constexpr int32 CHARS_PER_TOKEN_ESTIMATE{ 4 };
+
+    constexpr const char* const GPT_CUDA_BACKEND_NAME{ "ggml.cuda" };
+    constexpr const char* const GPT_CPU_BACKEND_NAME{ "ggml.cpu" };
+    constexpr const char* const GPT_SYNTHETIC_BACKEND_NAME{ "synthetic" };
+
+    // Where the GGML plugin's models live, under the nvigi models path
+    constexpr const TCHAR* const GPT_PLUGIN_MODELS_DIRECTORY{ TEXT("nvigi.plugin.gpt.ggml") };
+
+    // Short enough to keep loading fast, long enough to average out the first tokens
+    constexpr int32 LATENCY_PROBE_TOKENS{ 16 };
+    constexpr const TCHAR* const LATENCY_PROBE_PROMPT{ TEXT("Count from one to twenty, separated by commas.") };
+
+#if IGI_WITH_GPT_LORA
+    // Full strength; personas are trained to be applied as is
+    constexpr float LORA_SCALE{ 1.0f };
+#endif
+
+    // Changing the CPU backend's thread count reloads the model, from the file cache at best; at most this often
+    constexpr double MIN_SECONDS_BETWEEN_THREAD_COUNT_CHANGES{ 10.0 };
 }
 
 class FIGIGPT::Impl
@@ -25,34 +59,226 @@ class FIGIGPT::Impl
 public:
     Impl(FIGIModule* IGIModule) : IGIModulePtr(IGIModule)
     {
-        nvigi::Result Result = IGIModulePtr->CheckPluginCompatibility(nvigi::plugin::gpt::ggml::cuda::kId, "ggml.cuda");
+        const UIGISettings* Settings = GetDefault<UIGISettings>();
+        Backend = Settings->GetGPTBackend();
+
+        nvigi::Result Result = IGIModulePtr->CheckPluginCompatibility(GetFeatureId(), GetBackendName());
+
+        IGIModulePtr->LoadIGIFeature(GetFeatureId(), &GPTInterface, nullptr);
+
+        if (Backend == EIGIGPTBackend::Cpu)
+        {
+            // Variants are compared with every core the game can spare; the count is tuned once the variant is known
+            CPUThreads = MakeUnique<FIGICPUThreadManager>();
+            NumThreads = (Settings->CPUThreadCount > 0) ? Settings->CPUThreadCount : CPUThreads->GetMaxThreads();
+        }
+
+        SelectModel(Settings);
+
+        if (Backend == EIGIGPTBackend::Cpu && Settings->CPUThreadCount <= 0)
+        {
+            TuneCPUThreads();
+        }
+
+        if (CPUThreads)
+        {
+            CPUThreads->SetTunedThreads(NumThreads);
+        }
+    }
+
+    // Loads the configured model GUID, or the largest variant of the configured model that fits the machine
+    void SelectModel(const UIGISettings* Settings)
+    {
+        const uint64 MemoryBudgetMB = static_cast<uint64>(FMath::Max(0, Settings->ModelMemoryBudgetMB));
+        const FString PluginModelsPath = FPaths::Combine(IGIModulePtr->GetModelsPath(), GPT_PLUGIN_MODELS_DIRECTORY);
+        LoRAAdapters.SetCapacity(static_cast<uint64>(FMath::Max(0, Settings->LoRAMemoryBudgetMB)));
+
+        if (!Settings->ModelGUID.IsEmpty())
+        {
+            FIGIModelVariant Variant;
+            Variant.GUID = Settings->ModelGUID;
+            ReadIGIModelVariant(PluginModelsPath, Settings->ModelGUID, Variant);
+            SetModelVariant(MoveTemp(Variant));
+
+            if (!CreateInstance(Settings->ModelGUID, MemoryBudgetMB))
+            {
+                UE_LOG(LogIGISDK, Fatal, TEXT("Unable to create gpt.%s instance for model %s"), ANSI_TO_TCHAR(GetBackendName()), *Settings->ModelGUID);
+            }
+            return;
+        }
+
+        const TArray<FIGIModelVariant> Variants = FindIGIModelVariants(PluginModelsPath, Settings->ModelName);
+        if (Variants.Num() == 0)
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("No variant of %s found in %s; using the default model"), *Settings->ModelName, *PluginModelsPath);
+
+            FIGIModelVariant Variant;
+            Variant.GUID = GGUF_MODEL_MINITRON;
+            SetModelVariant(MoveTemp(Variant));
+
+            if (!CreateInstance(GGUF_MODEL_MINITRON, MemoryBudgetMB))
+            {
+                UE_LOG(LogIGISDK, Fatal, TEXT("Unable to create gpt.%s instance"), ANSI_TO_TCHAR(GetBackendName()));
+            }
+            return;
+        }
+
+        // Leave the game some room on the adapter, whatever the budget says
+        const uint64 FreeMemoryMB = IGIModulePtr->GetInferenceAdapterFreeMemoryMB();
+        const uint64 HeadroomMB = static_cast<uint64>(FMath::Max(0, Settings->MemoryHeadroomMB));
+        const uint64 AvailableMemoryMB = FMath::Min(MemoryBudgetMB, FreeMemoryMB > HeadroomMB ? FreeMemoryMB - HeadroomMB : 0);
+        UE_LOG(LogIGISDK, Log, TEXT("Selecting a model variant: %llu MB free on the inference adapter, %llu MB available to the model"), FreeMemoryMB, AvailableMemoryMB);
+
+        const TArray<int32> Ranking = RankIGIModelVariants(Variants, AvailableMemoryMB);
+        for (int32 Rank = 0; Rank < Ranking.Num(); ++Rank)
+        {
+            const FIGIModelVariant& Variant = Variants[Ranking[Rank]];
+            const bool bLastResort = (Rank == Ranking.Num() - 1);
+
+            SetModelVariant(FIGIModelVariant(Variant));
+            if (!CreateInstance(Variant.GUID, FMath::Max(MemoryBudgetMB, Variant.RequiredMemoryMB)))
+            {
+                UE_LOG(LogIGISDK, Warning, TEXT("Unable to load %s %s; trying a smaller variant"), *Variant.Name, *Variant.Quantization);
+                continue;
+            }
+
+            if (Settings->MaxMillisecondsPerToken > 0.0f && !bLastResort)
+            {
+                const float MillisecondsPerToken = MeasureMillisecondsPerToken();
+                if (MillisecondsPerToken > Settings->MaxMillisecondsPerToken)
+                {
+                    UE_LOG(LogIGISDK, Log, TEXT("%s %s generates at %.1f ms per token, above the %.1f ms target; trying a smaller variant"),
+                        *Variant.Name, *Variant.Quantization, MillisecondsPerToken, Settings->MaxMillisecondsPerToken);
+                    DestroyInstance();
+                    continue;
+                }
+            }
+
+            UE_LOG(LogIGISDK, Log, TEXT("Selected model %s %s (%s)"), *Variant.Name, *Variant.Quantization, *Variant.GUID);
+            return;
+        }
+
+        UE_LOG(LogIGISDK, Fatal, TEXT("Unable to create gpt.%s instance for any variant of %s"), ANSI_TO_TCHAR(GetBackendName()), *Settings->ModelName);
+    }
+
+    // Benchmarks thread counts on the selected model, or reads the count found on a previous run, and reloads with it
+    void TuneCPUThreads()
+    {
+        const int32 BestThreads = CPUThreads->Autotune(ModelVariant.GUID, [this](int32 Candidate)
+            {
+                if (!RecreateInstance(Candidate))
+                {
+                    return 0.0f;
+                }
+                const float MillisecondsPerToken = MeasureMillisecondsPerToken();
+                return (MillisecondsPerToken > 0.0f) ? 1000.0f / MillisecondsPerToken : 0.0f;
+            });
+
+        if (!RecreateInstance(BestThreads))
+        {
+            UE_LOG(LogIGISDK, Fatal, TEXT("Unable to create gpt.%s instance with %d threads"), ANSI_TO_TCHAR(GetBackendName()), BestThreads);
+        }
+    }
+
+    bool RecreateInstance(int32 InNumThreads)
+    {
+        if (GPTInstance != nullptr && InNumThreads == NumThreads)
+        {
+            return true;
+        }
+
+        DestroyInstance();
+        NumThreads = InNumThreads;
+        return CreateInstance(ModelVariant.GUID, ModelVRAMBudgetMB);
+    }
+
+    const nvigi::PluginID& GetFeatureId() const
+    {
+        switch (Backend)
+        {
+        case EIGIGPTBackend::Cpu:
+            return nvigi::plugin::gpt::ggml::cpu::kId;
+        case EIGIGPTBackend::Synthetic:
+            return IGISyntheticGPT::kId;
+        default:
+            return nvigi::plugin::gpt::ggml::cuda::kId;
+        }
+    }
+
+    const char* GetBackendName() const
+    {
+        switch (Backend)
+        {
+        case EIGIGPTBackend::Cpu:
+            return GPT_CPU_BACKEND_NAME;
+        case EIGIGPTBackend::Synthetic:
+            return GPT_SYNTHETIC_BACKEND_NAME;
+        default:
+            return GPT_CUDA_BACKEND_NAME;
+        }
+    }
+
+    // Records the model about to be loaded and picks the adapters loaded with it: as many as the LoRA budget allows,
+    // in the order the model lists them
+    void SetModelVariant(FIGIModelVariant&& Variant)
+    {
+        ModelVariant = MoveTemp(Variant);
 
-        IGIModulePtr->LoadIGIFeature(nvigi::plugin::gpt::ggml::cuda::kId, &GPTInterface, nullptr);
+        LoRAAdapters.Reset();
+        for (const FIGILoRAAdapter& Adapter : ModelVariant.Adapters)
+        {
+            if (!LoRAAdapters.Add(Adapter.Name, Adapter.RequiredMemoryMB))
+            {
+                UE_LOG(LogIGISDK, Warning, TEXT("%s: LoRA adapter %s does not fit in LoRAMemoryBudgetMB; its requests run on the base model"),
+                    ANSI_TO_TCHAR(__FUNCTION__), *Adapter.Name.ToString());
+            }
+        }
+    }
 
+    bool CreateInstance(const FString& ModelGUID, uint64 VRAMBudgetMB)
+    {
         nvigi::GPTCreationParameters params{};
+        params.contextSize = static_cast<int32_t>(CONTEXT_SIZE_RECOMMENDATION);
+        params.maxNumTokensToPredict = TOKENS_TO_PREDICT;
+        ModelVRAMBudgetMB = VRAMBudgetMB;
 
         nvigi::CommonCreationParameters common{};
         auto ConvertedString = StringCast<UTF8CHAR>(*IGIModulePtr->GetModelsPath());
+        auto ModelGUIDString = StringCast<ANSICHAR>(*ModelGUID);
         common.utf8PathToModels = reinterpret_cast<const char*>(ConvertedString.Get());
-        common.numThreads = THREAD_NUM_RECOMMENDATION;
-        common.vramBudgetMB = VRAM_BUDGET_RECOMMENDATION;
-        common.modelGUID = GGUF_MODEL_MINITRON;
-        Result = params.chain(common);
+        common.numThreads = (Backend == EIGIGPTBackend::Cpu) ? NumThreads : THREAD_NUM_RECOMMENDATION;
+        common.vramBudgetMB = VRAMBudgetMB;
+        common.modelGUID = ModelGUIDString.Get();
+        nvigi::Result Result = params.chain(common);
         if (Result != nvigi::kResultOk)
         {
             UE_LOG(LogIGISDK, Error, TEXT("Unable to chain common parameters; cannot use CiG: %s"), *GetIGIStatusString(Result));
             GPTInstance = nullptr;
-            return;
+            return false;
         }
         
-        if (GDynamicRHI && GDynamicRHI->GetInterfaceType() == ERHIInterfaceType::D3D12)
+        if (Backend != EIGIGPTBackend::Cuda)
         {
-            Result = params.chain(IGIModulePtr->GetD3D12Parameters());
+            // Nothing to share with the renderer
+        }
+        else if (GDynamicRHI && GDynamicRHI->GetInterfaceType() == ERHIInterfaceType::D3D12)
+        {
+            // Also what puts inference on the selected adapter: nvigi runs on the adapter of the device it is given.
+            // On another adapter than the engine's, that device is our own and nothing is shared with the renderer.
+            const nvigi::D3D12Parameters D3D12Parameters = IGIModulePtr->GetD3D12Parameters();
+            if (D3D12Parameters.device == nullptr && !IGIModulePtr->IsInferenceOnRenderAdapter())
+            {
+                UE_LOG(LogIGISDK, Error, TEXT("No D3D12 device on the selected inference adapter; refusing to run on the render adapter instead"));
+                GPTInstance = nullptr;
+                return false;
+            }
+
+            Result = params.chain(D3D12Parameters);
             if (Result != nvigi::kResultOk)
             {
                 UE_LOG(LogIGISDK, Error, TEXT("Unable to chain D3D12 parameters; cannot use CiG: %s"), *GetIGIStatusString(Result));
                 GPTInstance = nullptr;
-                return;
+                return false;
             }
         }
         else if (GDynamicRHI && GDynamicRHI->GetInterfaceType() == ERHIInterfaceType::Vulkan)
@@ -62,37 +288,116 @@ public:
             {
                 UE_LOG(LogIGISDK, Error, TEXT("Unable to chain Vulkan parameters; cannot use CiG: %s"), *GetIGIStatusString(Result));
                 GPTInstance = nullptr;
-                return;
+                return false;
+            }
+        }
+
+#if IGI_WITH_GPT_LORA
+        // Adapters are bound to the instance when it is created; nvigi finds their weights through the model config
+        std::vector<std::string> LoRANames;
+        std::vector<const char*> LoRANamePtrs;
+        std::vector<float> LoRAScales;
+        for (const FName& AdapterName : LoRAAdapters.GetLoaded())
+        {
+            LoRANames.push_back(TCHAR_TO_UTF8(*AdapterName.ToString()));
+        }
+        for (const std::string& LoRAName : LoRANames)
+        {
+            LoRANamePtrs.push_back(LoRAName.c_str());
+            LoRAScales.push_back(LORA_SCALE);
+        }
+
+        nvigi::GPTCreationParametersEx paramsEx{};
+        paramsEx.numLoras = LoRANamePtrs.size();
+        paramsEx.loraNames = LoRANamePtrs.data();
+        paramsEx.loraScales = LoRAScales.data();
+        if (!LoRANamePtrs.empty())
+        {
+            Result = params.chain(paramsEx);
+            if (Result != nvigi::kResultOk)
+            {
+                UE_LOG(LogIGISDK, Error, TEXT("Unable to chain LoRA parameters: %s"), *GetIGIStatusString(Result));
+                GPTInstance = nullptr;
+                return false;
             }
         }
+#endif
 
         Result = GPTInterface->createInstance(params, &GPTInstance);
         if (Result != nvigi::kResultOk)
         {
-            UE_LOG(LogIGISDK, Fatal, TEXT("Unable to create gpt.ggml.cuda instance: %s"), *GetIGIStatusString(Result));
+            UE_LOG(LogIGISDK, Error, TEXT("Unable to create gpt.%s instance: %s"), ANSI_TO_TCHAR(GetBackendName()), *GetIGIStatusString(Result));
             GPTInstance = nullptr;
-            return;
+            return false;
         }
+
+        // The backend's threads are new; they are pinned during the next evaluation
+        bCaptureCPUThreads = CPUThreads.IsValid();
+        return true;
     }
 
-    virtual ~Impl()
+    void DestroyInstance()
     {
         if (GPTInstance != nullptr)
         {
             GPTInterface->destroyInstance(GPTInstance);
             GPTInstance = nullptr;
         }
+    }
+
+    // Decode speed only: the time to the first token depends on the prompt, not on the quantization
+    float MeasureMillisecondsPerToken()
+    {
+        int32 NumTokens{ 0 };
+        double FirstTokenTime{ 0.0 };
+        double LastTokenTime{ 0.0 };
+
+        Evaluate({ FString(), LATENCY_PROBE_PROMPT, FString() }, [&](const FString&)
+            {
+                LastTokenTime = FPlatformTime::Seconds();
+                if (NumTokens++ == 0)
+                {
+                    FirstTokenTime = LastTokenTime;
+                }
+                return NumTokens < LATENCY_PROBE_TOKENS;
+            });
+
+        return (NumTokens > 1) ? static_cast<float>((LastTokenTime - FirstTokenTime) * 1000.0 / (NumTokens - 1)) : 0.0f;
+    }
+
+    virtual ~Impl()
+    {
+        if (ThreadCountChange.IsValid())
+        {
+            ThreadCountChange.Wait();
+        }
+        DestroyInstance();
 
         if (IGIModulePtr)
         {
-            IGIModulePtr->UnloadIGIFeature(nvigi::plugin::gpt::ggml::cuda::kId, GPTInterface);
+            IGIModulePtr->UnloadIGIFeature(GetFeatureId(), GPTInterface);
             IGIModulePtr = nullptr;
         }
     }
 
-    FString Evaluate(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt)
+    FString Evaluate(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
     {
-        FScopeLock Lock(&CS);
+        // A model evaluates one request at a time; the synthetic backend keeps no state per evaluation and takes them all at once
+        TOptional<FScopeLock> Lock;
+        if (Backend != EIGIGPTBackend::Synthetic)
+        {
+            Lock.Emplace(&CS);
+        }
+
+        if (GPTInstance == nullptr)
+        {
+            UE_LOG(LogIGISDK, Error, TEXT("%s: no GPT instance"), ANSI_TO_TCHAR(__FUNCTION__));
+            return FString();
+        }
+
+        const FString& SystemPrompt = Request.SystemPrompt;
+        const FString& UserPrompt = Request.UserPrompt;
+        const FString& AssistantPrompt = Request.AssistantPrompt;
 
         struct BasicCallbackCtx
         {
@@ -100,6 +405,11 @@ public:
             std::condition_variable callbackCV;
             std::atomic<nvigi::InferenceExecutionState> callbackState = nvigi::kInferenceExecutionStateDataPending;
             FString gptOutput;
+            const FTokenCallback* onToken{};
+            bool bCancelRequested{ false };
+            int32 numResponses{ 0 };
+            FIGICPUThreadManager* threadsToCapture{};
+            int32 numThreads{ 0 };
         };
         BasicCallbackCtx cbkCtx;
 
@@ -125,12 +435,27 @@ public:
                 else
                 {
                     cbkCtx->gptOutput += response;
+                    ++cbkCtx->numResponses;
+
+                    // ggml's workers are running now, whether it keeps them between evaluations or not
+                    if (cbkCtx->threadsToCapture)
+                    {
+                        cbkCtx->threadsToCapture->EndCaptureThreads(cbkCtx->numThreads);
+                        cbkCtx->threadsToCapture = nullptr;
+                    }
+
+                    // Tokens still in flight after a cancel are not the caller's any more
+                    if (!cbkCtx->bCancelRequested && *cbkCtx->onToken && !response.IsEmpty() && !(*cbkCtx->onToken)(response))
+                    {
+                        cbkCtx->bCancelRequested = true;
+                    }
                 }
 
+                // The waiter only wakes on Done or Invalid: nvigi may call back until then, and cbkCtx lives on its stack
                 cbkCtx->callbackState = state;
                 cbkCtx->callbackCV.notify_one();
 
-                return state;
+                return cbkCtx->bCancelRequested ? nvigi::kInferenceExecutionStateCancel : state;
             };
 
         auto SystemPromptUTF = StringCast<UTF8CHAR>(*SystemPrompt);
@@ -158,10 +483,32 @@ public:
 
         // Parameters
         nvigi::GPTRuntimeParameters runtime{};
-        runtime.seed = -1;
-        runtime.tokensToPredict = 200;
+        runtime.seed = Request.Seed;
+        runtime.tokensToPredict = TOKENS_TO_PREDICT;
         runtime.interactive = false;
 
+#if IGI_WITH_GPT_LORA
+        const bool bApplyAdapter = PrepareAdapter(Request.Adapter);
+        const auto AdapterNameUTF8 = StringCast<UTF8CHAR>(*Request.Adapter.ToString());
+        const char* AdapterNamePtr = reinterpret_cast<const char*>(AdapterNameUTF8.Get());
+        const float AdapterScale = LORA_SCALE;
+
+        nvigi::GPTRuntimeParametersEx runtimeEx{};
+        if (bApplyAdapter)
+        {
+            runtimeEx.numLoras = 1;
+            runtimeEx.loraNames = &AdapterNamePtr;
+            runtimeEx.loraScales = &AdapterScale;
+            const nvigi::Result Result = runtime.chain(runtimeEx);
+            if (Result != nvigi::kResultOk)
+            {
+                UE_LOG(LogIGISDK, Warning, TEXT("%s: unable to chain LoRA parameters, using the base model: %s"), ANSI_TO_TCHAR(__FUNCTION__), *GetIGIStatusString(Result));
+            }
+        }
+#else
+        PrepareAdapter(Request.Adapter);
+#endif
+
         nvigi::InferenceExecutionContext gptCtx{};
         nvigi::InferenceInstance* instance = GPTInstance;
         gptCtx.instance = instance;
@@ -171,6 +518,21 @@ public:
         gptCtx.runtimeParameters = runtime;
 
         cbkCtx.callbackState = nvigi::kInferenceExecutionStateDataPending;
+        cbkCtx.onToken = &OnToken;
+        cbkCtx.bCancelRequested = false;
+
+        const double StartTime = FPlatformTime::Seconds();
+        if (CPUThreads)
+        {
+            CPUThreads->OnRequestStarted();
+            if (bCaptureCPUThreads)
+            {
+                bCaptureCPUThreads = false;
+                CPUThreads->BeginCaptureThreads();
+                cbkCtx.threadsToCapture = CPUThreads.Get();
+                cbkCtx.numThreads = NumThreads;
+            }
+        }
 
         instance->evaluateAsync(&gptCtx);
 
@@ -178,18 +540,109 @@ public:
             std::unique_lock lck(cbkCtx.callbackMutex);
             cbkCtx.callbackCV.wait(lck, [&cbkCtx]()
                 {
-                    return cbkCtx.callbackState != nvigi::kInferenceExecutionStateDataPending;
+                    return cbkCtx.callbackState == nvigi::kInferenceExecutionStateDone || cbkCtx.callbackState == nvigi::kInferenceExecutionStateInvalid;
                 });
         }
 
-        FString response(cbkCtx.gptOutput);
+        if (CPUThreads)
+        {
+            // One response per token with the GGML plugin
+            CPUThreads->OnRequestFinished(cbkCtx.numResponses, FPlatformTime::Seconds() - StartTime);
+
+            // Nothing was generated to capture the threads with; try again with the next request
+            bCaptureCPUThreads |= (cbkCtx.threadsToCapture != nullptr);
+
+            ScheduleThreadCountChange();
+        }
+
+        FString response(MoveTemp(cbkCtx.gptOutput));
 
         return response;
     }
 
+    // nvigi takes the thread count at creation only, so the instance is recreated with the count the game load calls for;
+    // on a pool thread once this request is done, and any request sent meanwhile waits for the lock. Called under the lock.
+    void ScheduleThreadCountChange()
+    {
+        if (CPUThreads->GetTargetThreads() == NumThreads
+            || (ThreadCountChange.IsValid() && !ThreadCountChange.IsReady())
+            || FPlatformTime::Seconds() - LastThreadCountChangeSeconds < MIN_SECONDS_BETWEEN_THREAD_COUNT_CHANGES)
+        {
+            return;
+        }
+        LastThreadCountChangeSeconds = FPlatformTime::Seconds();
+
+        ThreadCountChange = Async(EAsyncExecution::ThreadPool, [this]()
+            {
+                FScopeLock Lock(&CS);
+
+                const int32 PreviousThreads = NumThreads;
+                const int32 TargetThreads = CPUThreads->GetTargetThreads();
+                if (TargetThreads == PreviousThreads)
+                {
+                    return;
+                }
+
+                UE_LOG(LogIGISDK, Log, TEXT("%s: reloading with %d threads instead of %d for the game load"), ANSI_TO_TCHAR(__FUNCTION__), TargetThreads, PreviousThreads);
+                if (!RecreateInstance(TargetThreads) && !RecreateInstance(PreviousThreads))
+                {
+                    UE_LOG(LogIGISDK, Error, TEXT("%s: unable to recreate gpt.%s instance"), ANSI_TO_TCHAR(__FUNCTION__), ANSI_TO_TCHAR(GetBackendName()));
+                }
+            });
+    }
+
+    // Whether the request's adapter was loaded with the instance; when it was not, the request runs on the base model.
+    // Loading it would mean recreating the instance, a full model reload under the lock for a single request.
+    bool PrepareAdapter(FName AdapterName)
+    {
+        if (AdapterName.IsNone())
+        {
+            return false;
+        }
+
+#if IGI_WITH_GPT_LORA
+        const FIGILoRAAdapter* Adapter = ModelVariant.Adapters.FindByPredicate([AdapterName](const FIGILoRAAdapter& Candidate)
+            {
+                return Candidate.Name == AdapterName;
+            });
+        if (Adapter == nullptr)
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("%s: model %s has no LoRA adapter %s; using the base model"), ANSI_TO_TCHAR(__FUNCTION__), *ModelVariant.GUID, *AdapterName.ToString());
+            return false;
+        }
+
+        // Reported once when the model is loaded
+        return LoRAAdapters.IsLoaded(AdapterName);
+#else
+        static bool bWarned{ false };
+        if (!bWarned)
+        {
+            bWarned = true;
+            UE_LOG(LogIGISDK, Warning, TEXT("%s: this GPT plugin does not support LoRA adapters; requests run on the base model"), ANSI_TO_TCHAR(__FUNCTION__));
+        }
+        return false;
+#endif
+    }
+
+    const FString& GetModelGUID() const
+    {
+        return ModelVariant.GUID;
+    }
+
 private:
     FCriticalSection CS;
 
+    FIGIModelVariant ModelVariant;
+    uint64 ModelVRAMBudgetMB{ 0 };
+    FIGILoRAAdapters LoRAAdapters;
+
+    EIGIGPTBackend Backend{ EIGIGPTBackend::Cuda };
+    int32 NumThreads{ THREAD_NUM_RECOMMENDATION };
+    TUniquePtr<FIGICPUThreadManager> CPUThreads;
+    bool bCaptureCPUThreads{ false };
+    TFuture<void> ThreadCountChange;
+    double LastThreadCountChangeSeconds{ 0.0 };
+
     // Non-owning ptr
     FIGIModule* IGIModulePtr;
 
@@ -204,9 +657,466 @@ FIGIGPT::FIGIGPT(FIGIModule* IGIModule)
     Pimpl = MakePimpl<FIGIGPT::Impl>(IGIModule);
 }
 
-FIGIGPT::~FIGIGPT() {}
+FIGIGPT::FIGIGPT() {}
+
+FIGIGPT::~FIGIGPT()
+{
+    // Too late for a subclass's EvaluateRequest, hence FIGIModule calls it beforehand
+    CancelAndWait();
+}
+
+void FIGIGPT::CancelAndWait()
+{
+    check(IsInGameThread());
+
+    bCancellingAll = true;
+
+    FTSTicker::GetCoreTicker().RemoveTicker(DraftTickHandle);
+    DraftTickHandle.Reset();
+    FTSTicker::GetCoreTicker().RemoveTicker(IdleTickHandle);
+    IdleTickHandle.Reset();
+    PendingDraft.Reset();
+    CancelDraftEvaluation();
+    IdleRequests.Reset();
+
+    // Nothing adds to the counts off the game thread, and each task's decrement is the last it does with this
+    while (NumPendingRequests.load() > 0 || NumDraftRequests.load() > 0 || NumSpeculativeRequests.load() > 0)
+    {
+        FPlatformProcess::Sleep(0.001f);
+    }
+}
 
 FString FIGIGPT::Evaluate(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt)
 {
-    return Pimpl->Evaluate(SystemPrompt, UserPrompt, AssistantPrompt);
+    return Evaluate({ SystemPrompt, UserPrompt, AssistantPrompt }, nullptr);
+}
+
+FString FIGIGPT::Evaluate(const FIGIGPTRequest& Request)
+{
+    return Evaluate(Request, nullptr);
+}
+
+FString FIGIGPT::Evaluate(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
+{
+    if (bCancellingAll.load())
+    {
+        return FString();
+    }
+
+    const FTokenCallback Continue = [this, &OnToken](const FString& Token)
+        {
+            return !bCancellingAll.load() && (!OnToken || OnToken(Token));
+        };
+
+    const TSharedPtr<FIGIGPTTraceRecorder, ESPMode::ThreadSafe> Recorder = FIGIGPTTraceRecorder::GetActive();
+    if (!Recorder)
+    {
+        return EvaluateRequest(Request, Continue);
+    }
+
+    FIGIGPTTraceRecord Record;
+    Record.StartSeconds = Recorder->GetSeconds();
+    Record.Request = Request;
+    Record.ModelGUID = GetModelGUID();
+    Record.Backend = GetBackendName();
+    Record.MaxTokensToPredict = GetMaxTokensToPredict();
+
+    const double StartTime = FPlatformTime::Seconds();
+    FString Response = EvaluateRequest(Request, [&Record, &Continue, StartTime](const FString& Token)
+        {
+            Record.Tokens.Add({ static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0), Token });
+
+            const bool bContinue = Continue(Token);
+            Record.bCancelled |= !bContinue;
+            return bContinue;
+        });
+    Record.TotalMilliseconds = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+    Recorder->Write(Record);
+    return Response;
+}
+
+FString FIGIGPT::EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
+{
+    return Pimpl->Evaluate(Request, OnToken);
+}
+
+void FIGIGPT::EvaluateAsync(FIGIGPTRequest&& Request, FResponseCallback&& OnResponse)
+{
+    EvaluateAsync(MoveTemp(Request), FTokenCallback(), MoveTemp(OnResponse));
+}
+
+void FIGIGPT::EvaluateAsync(FIGIGPTRequest&& Request, FTokenCallback&& OnToken, FResponseCallback&& OnResponse)
+{
+    FString Ready;
+    FIGIPregeneration* Pregeneration = FIGIModule::Get().GetPregeneration();
+    if (FIGIModule::Get().FindBakedResponse(Request, Ready) || Pregeneration->TakeResponse(Request, Ready))
+    {
+        // Same threads as a generated response, so that callers cannot tell the difference
+        AsyncTask(ENamedThreads::AnyBackgroundHiPriTask, [Ready = MoveTemp(Ready), OnToken = MoveTemp(OnToken), OnResponse = MoveTemp(OnResponse)]() mutable
+            {
+                if (OnToken)
+                {
+                    OnToken(Ready);
+                }
+
+                AsyncTask(ENamedThreads::GameThread, [Ready = MoveTemp(Ready), OnResponse = MoveTemp(OnResponse)]() mutable
+                    {
+                        OnResponse(MoveTemp(Ready));
+                    });
+            });
+        return;
+    }
+
+    // The request goes to the model; what was anticipated waits
+    Pregeneration->Abandon();
+
+    if (AdoptDraftEvaluation(Request, OnToken, OnResponse))
+    {
+        return;
+    }
+
+    // The request and the callbacks are moved through both thread hops; nothing is copied.
+    ++NumPendingRequests;
+    AsyncTask(ENamedThreads::AnyBackgroundHiPriTask, [this, Request = MoveTemp(Request), OnToken = MoveTemp(OnToken), OnResponse = MoveTemp(OnResponse)]() mutable
+        {
+            FString Response = Evaluate(Request, OnToken);
+            --NumPendingRequests;
+
+            AsyncTask(ENamedThreads::GameThread, [Response = MoveTemp(Response), OnResponse = MoveTemp(OnResponse)]() mutable
+                {
+                    OnResponse(MoveTemp(Response));
+                });
+        });
+}
+
+void FIGIGPT::EvaluateSpeculatively(FIGIGPTRequest&& Request, FTokenCallback&& OnToken, FResponseCallback&& OnResponse)
+{
+    check(IsInGameThread());
+
+    ++NumSpeculativeRequests;
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Request = MoveTemp(Request), OnToken = MoveTemp(OnToken), OnResponse = MoveTemp(OnResponse)]() mutable
+        {
+            FString Response = Evaluate(Request, OnToken);
+            --NumSpeculativeRequests;
+
+            AsyncTask(ENamedThreads::GameThread, [Response = MoveTemp(Response), OnResponse = MoveTemp(OnResponse)]() mutable
+                {
+                    OnResponse(MoveTemp(Response));
+                });
+        });
+}
+
+// nvigi keeps no KV state across requests and has no call to read or write it, so a draft cannot be prefilled on its own and rolled
+// back by its changed suffix; the whole draft is evaluated instead, and kept when it turns out to be the request sent.
+struct FIGIGPT::FDraftEvaluation
+{
+    FIGIGPTRequest Request;
+
+    FCriticalSection CS;
+    TArray<FString> Tokens;
+    FString Response;
+    bool bDone{ false };
+    bool bCancelled{ false };
+
+    // Set once EvaluateAsync has taken the evaluation over; the callbacks are set on the background thread after that
+    bool bAdopted{ false };
+    FTokenCallback OnToken;
+    FResponseCallback OnResponse;
+};
+
+void FIGIGPT::UpdateDraft(const FIGIGPTRequest& Draft)
+{
+    check(IsInGameThread());
+
+    if (!GetDefault<UIGISettings>()->bEvaluateDrafts)
+    {
+        return;
+    }
+
+    if ((PendingDraft.IsSet() && PendingDraft.GetValue().Matches(Draft))
+        || (!PendingDraft.IsSet() && DraftEvaluation && DraftEvaluation->Request.Matches(Draft)))
+    {
+        return;
+    }
+
+    CancelDraftEvaluation();
+
+    // Sent as it is, a baked request is answered at once anyway
+    FString Baked;
+    if (FIGIModule::Get().FindBakedResponse(Draft, Baked))
+    {
+        PendingDraft.Reset();
+        return;
+    }
+
+    SetDraft(CopyTemp(Draft));
+}
+
+void FIGIGPT::ClearDraft()
+{
+    check(IsInGameThread());
+
+    PendingDraft.Reset();
+    CancelDraftEvaluation();
+}
+
+void FIGIGPT::SetDraft(FIGIGPTRequest&& Draft)
+{
+    PendingDraft = MoveTemp(Draft);
+    PendingDraftSeconds = FPlatformTime::Seconds();
+
+    if (!DraftTickHandle.IsValid())
+    {
+        DraftTickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FIGIGPT::TickDraft));
+    }
+}
+
+bool FIGIGPT::TickDraft(float /*DeltaTime*/)
+{
+    if (!PendingDraft.IsSet())
+    {
+        DraftTickHandle.Reset();
+        return false;
+    }
+
+    // Only in idle time: a draft never delays a request, and waits for a cancelled draft to wind down
+    if (FPlatformTime::Seconds() - PendingDraftSeconds < GetDefault<UIGISettings>()->DraftDebounceSeconds
+        || NumPendingRequests.load() > 0 || NumDraftRequests.load() > 0)
+    {
+        return true;
+    }
+
+    FIGIModule::Get().GetPregeneration()->Abandon();
+
+    TSharedRef<FDraftEvaluation, ESPMode::ThreadSafe> Evaluation = MakeShared<FDraftEvaluation, ESPMode::ThreadSafe>();
+    Evaluation->Request = MoveTemp(PendingDraft.GetValue());
+    PendingDraft.Reset();
+    DraftEvaluation = Evaluation;
+
+    ++NumDraftRequests;
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Evaluation]()
+        {
+            FString Response = Evaluate(Evaluation->Request, [&Evaluation](const FString& Token)
+                {
+                    FScopeLock Lock(&Evaluation->CS);
+                    if (Evaluation->bCancelled)
+                    {
+                        return false;
+                    }
+
+                    Evaluation->Tokens.Add(Token);
+                    return !Evaluation->OnToken || Evaluation->OnToken(Token);
+                });
+
+            FResponseCallback OnResponse;
+            {
+                FScopeLock Lock(&Evaluation->CS);
+                Evaluation->bDone = true;
+                Evaluation->Response = Response;
+                OnResponse = MoveTemp(Evaluation->OnResponse);
+            }
+            --NumDraftRequests;
+
+            // Otherwise not adopted, or adopted but the tokens so far are still being handed over, which responds then
+            if (OnResponse)
+            {
+                --NumPendingRequests;
+                AsyncTask(ENamedThreads::GameThread, [Response = MoveTemp(Response), OnResponse = MoveTemp(OnResponse)]() mutable
+                    {
+                        OnResponse(MoveTemp(Response));
+                    });
+            }
+        });
+
+    DraftTickHandle.Reset();
+    return false;
+}
+
+void FIGIGPT::EvaluateWhenIdle(FIGIGPTRequest&& Request, FResponseCallback&& OnResponse)
+{
+    check(IsInGameThread());
+
+    IdleRequests.Add({ MoveTemp(Request), MoveTemp(OnResponse) });
+    if (!IdleTickHandle.IsValid())
+    {
+        IdleTickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FIGIGPT::TickIdleRequests));
+    }
+}
+
+bool FIGIGPT::TickIdleRequests(float /*DeltaTime*/)
+{
+    if (IdleRequests.IsEmpty())
+    {
+        IdleTickHandle.Reset();
+        return false;
+    }
+
+    // Not through EvaluateAsync, which would abandon the very speculative work this waits for
+    const FIGIPregeneration* Pregeneration = FIGIModule::Get().GetPregeneration();
+    if (NumPendingRequests.load() > 0 || NumDraftRequests.load() > 0 || PendingDraft.IsSet() || !Pregeneration->IsIdle())
+    {
+        return true;
+    }
+
+    FIdleRequest Next = MoveTemp(IdleRequests[0]);
+    IdleRequests.RemoveAt(0);
+
+    ++NumPendingRequests;
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Request = MoveTemp(Next.Request), OnResponse = MoveTemp(Next.OnResponse)]() mutable
+        {
+            FString Response = Evaluate(Request, FTokenCallback());
+            --NumPendingRequests;
+
+            AsyncTask(ENamedThreads::GameThread, [Response = MoveTemp(Response), OnResponse = MoveTemp(OnResponse)]() mutable
+                {
+                    OnResponse(MoveTemp(Response));
+                });
+        });
+    return true;
+}
+
+void FIGIGPT::CancelDraftEvaluation()
+{
+    if (!DraftEvaluation)
+    {
+        return;
+    }
+
+    {
+        FScopeLock Lock(&DraftEvaluation->CS);
+        DraftEvaluation->bCancelled |= !DraftEvaluation->bAdopted;
+    }
+    DraftEvaluation.Reset();
+}
+
+bool FIGIGPT::AdoptDraftEvaluation(const FIGIGPTRequest& Request, FTokenCallback& OnToken, FResponseCallback& OnResponse)
+{
+    check(IsInGameThread());
+
+    if (PendingDraft.IsSet() && PendingDraft.GetValue().Matches(Request))
+    {
+        PendingDraft.Reset();
+    }
+
+    TSharedPtr<FDraftEvaluation, ESPMode::ThreadSafe> Evaluation = MoveTemp(DraftEvaluation);
+    if (!Evaluation)
+    {
+        return false;
+    }
+
+    if (!Evaluation->Request.Matches(Request))
+    {
+        // Out of the way of the request; the draft is evaluated again once the GPT is idle, unless it changed meanwhile
+        FScopeLock Lock(&Evaluation->CS);
+        Evaluation->bCancelled = true;
+        if (!PendingDraft.IsSet())
+        {
+            SetDraft(CopyTemp(Evaluation->Request));
+        }
+        return false;
+    }
+
+    {
+        FScopeLock Lock(&Evaluation->CS);
+        if (Evaluation->bCancelled)
+        {
+            return false;
+        }
+        Evaluation->bAdopted = true;
+
+        UE_LOG(LogIGISDK, Verbose, TEXT("%s: taking over the draft's evaluation, %d tokens in%s"), ANSI_TO_TCHAR(__FUNCTION__),
+            Evaluation->Tokens.Num(), Evaluation->bDone ? TEXT(", done") : TEXT(""));
+    }
+
+    // The tokens so far are handed over on a background thread like any other token, and the rest follow from the evaluation
+    ++NumPendingRequests;
+    AsyncTask(ENamedThreads::AnyBackgroundHiPriTask, [this, Evaluation, OnToken = MoveTemp(OnToken), OnResponse = MoveTemp(OnResponse)]() mutable
+        {
+            FScopeLock Lock(&Evaluation->CS);
+
+            bool bContinue{ true };
+            for (int32 TokenIndex = 0; bContinue && OnToken && TokenIndex < Evaluation->Tokens.Num(); ++TokenIndex)
+            {
+                bContinue = OnToken(Evaluation->Tokens[TokenIndex]);
+            }
+            Evaluation->bCancelled = !bContinue;
+            Evaluation->OnToken = MoveTemp(OnToken);
+
+            if (!Evaluation->bDone)
+            {
+                Evaluation->OnResponse = MoveTemp(OnResponse);
+                return;
+            }
+
+            --NumPendingRequests;
+            AsyncTask(ENamedThreads::GameThread, [Response = Evaluation->Response, OnResponse = MoveTemp(OnResponse)]() mutable
+                {
+                    OnResponse(MoveTemp(Response));
+                });
+        });
+    return true;
+}
+
+// nvigi does not expose the model tokenizer, so this is an estimate. Only the count for letters is an average: one token
+// per started group of CHARS_PER_TOKEN_ESTIMATE letters in a word. Digits, which Llama vocabularies split one by one, and
+// punctuation count one token each, and non-ASCII characters one per UTF-8 byte, the worst case of byte fallback; CJK text
+// would be undercounted otherwise.
+int32 FIGIGPT::CountTokens(FStringView Text)
+{
+    int32 NumTokens{ 0 };
+    int32 WordLength{ 0 };
+
+    auto EndWord = [&NumTokens, &WordLength]()
+        {
+            NumTokens += (WordLength + CHARS_PER_TOKEN_ESTIMATE - 1) / CHARS_PER_TOKEN_ESTIMATE;
+            WordLength = 0;
+        };
+
+    for (const TCHAR Char : Text)
+    {
+        if (FChar::IsWhitespace(Char))
+        {
+            EndWord();
+        }
+        else if (Char < 128 && FChar::IsAlpha(Char))
+        {
+            ++WordLength;
+        }
+        else if (Char < 128)
+        {
+            EndWord();
+            ++NumTokens;
+        }
+        else
+        {
+            // Half of a UTF-16 surrogate pair takes half of its 4 bytes
+            const uint32 CodePoint = static_cast<uint32>(Char);
+            EndWord();
+            NumTokens += (CodePoint < 0x800 || (CodePoint >= 0xD800 && CodePoint < 0xE000)) ? 2 : (CodePoint < 0x10000 ? 3 : 4);
+        }
+    }
+    EndWord();
+
+    return NumTokens;
+}
+
+FString FIGIGPT::GetModelGUID() const
+{
+    return Pimpl ? Pimpl->GetModelGUID() : FString();
+}
+
+FString FIGIGPT::GetBackendName() const
+{
+    return Pimpl ? FString(Pimpl->GetBackendName()) : FString();
+}
+
+int32 FIGIGPT::GetContextSize()
+{
+    return static_cast<int32>(CONTEXT_SIZE_RECOMMENDATION);
+}
+
+int32 FIGIGPT::GetMaxTokensToPredict()
+{
+    return TOKENS_TO_PREDICT;
 }
@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Sockets.h"
+
+#include "IGIGPT.h"
+
+/**
+ * Wire format between FIGIGPTServer and FIGIGPTRemote. Both ends run on the same machine, so values are sent in
+ * native byte order. Every frame is a uint32 payload size, a uint8 frame type and the payload.
+ *
+ * Client -> server: Request (system, user and assistant prompts and adapter name as length-prefixed UTF-8)
+ * Server -> client: any number of Token (UTF-8 text) followed by Done (empty) or Error (UTF-8 message)
+ *
+ * A client cancels a request by closing its connection.
+ */
+namespace IGIGPTProtocol
+{
+    enum class EFrameType : uint8
+    {
+        Request = 1,
+        Token = 2,
+        Done = 3,
+        Error = 4,
+    };
+
+    // Frames larger than this are treated as a protocol error
+    constexpr uint32 MAX_PAYLOAD_SIZE{ 16u * 1024u * 1024u };
+
+    inline bool SendAll(FSocket& Socket, const uint8* Data, int32 Size)
+    {
+        while (Size > 0)
+        {
+            int32 Sent{ 0 };
+            if (!Socket.Send(Data, Size, Sent) || Sent <= 0)
+            {
+                return false;
+            }
+            Data += Sent;
+            Size -= Sent;
+        }
+        return true;
+    }
+
+    inline bool ReceiveAll(FSocket& Socket, uint8* Data, int32 Size)
+    {
+        while (Size > 0)
+        {
+            int32 Read{ 0 };
+            if (!Socket.Recv(Data, Size, Read) || Read <= 0)
+            {
+                return false;
+            }
+            Data += Read;
+            Size -= Read;
+        }
+        return true;
+    }
+
+    inline bool SendFrame(FSocket& Socket, EFrameType Type, TConstArrayView<uint8> Payload)
+    {
+        uint8 Header[sizeof(uint32) + sizeof(uint8)];
+        const uint32 PayloadSize = static_cast<uint32>(Payload.Num());
+        FMemory::Memcpy(Header, &PayloadSize, sizeof(uint32));
+        Header[sizeof(uint32)] = static_cast<uint8>(Type);
+
+        return SendAll(Socket, Header, sizeof(Header)) && SendAll(Socket, Payload.GetData(), Payload.Num());
+    }
+
+    inline bool SendTextFrame(FSocket& Socket, EFrameType Type, const FString& Text)
+    {
+        const auto TextUTF8 = StringCast<UTF8CHAR>(*Text);
+        return SendFrame(Socket, Type, TConstArrayView<uint8>(reinterpret_cast<const uint8*>(TextUTF8.Get()), TextUTF8.Length()));
+    }
+
+    inline bool ReceiveFrame(FSocket& Socket, EFrameType& OutType, TArray<uint8>& OutPayload)
+    {
+        uint8 Header[sizeof(uint32) + sizeof(uint8)];
+        if (!ReceiveAll(Socket, Header, sizeof(Header)))
+        {
+            return false;
+        }
+
+        uint32 PayloadSize{ 0 };
+        FMemory::Memcpy(&PayloadSize, Header, sizeof(uint32));
+        OutType = static_cast<EFrameType>(Header[sizeof(uint32)]);
+
+        if (PayloadSize > MAX_PAYLOAD_SIZE)
+        {
+            return false;
+        }
+
+        OutPayload.SetNumUninitialized(static_cast<int32>(PayloadSize), EAllowShrinking::No);
+        return ReceiveAll(Socket, OutPayload.GetData(), OutPayload.Num());
+    }
+
+    inline FString PayloadToString(TConstArrayView<uint8> Payload)
+    {
+        return FString(Payload.Num(), reinterpret_cast<const UTF8CHAR*>(Payload.GetData()));
+    }
+
+    inline void WriteString(TArray<uint8>& Payload, const FString& Text)
+    {
+        const auto TextUTF8 = StringCast<UTF8CHAR>(*Text);
+        const uint32 Size = static_cast<uint32>(TextUTF8.Length());
+        Payload.Append(reinterpret_cast<const uint8*>(&Size), sizeof(uint32));
+        Payload.Append(reinterpret_cast<const uint8*>(TextUTF8.Get()), TextUTF8.Length());
+    }
+
+    inline bool ReadString(TConstArrayView<uint8> Payload, int32& Offset, FString& OutText)
+    {
+        uint32 Size{ 0 };
+        if (Offset + static_cast<int32>(sizeof(uint32)) > Payload.Num())
+        {
+            return false;
+        }
+        FMemory::Memcpy(&Size, Payload.GetData() + Offset, sizeof(uint32));
+        Offset += sizeof(uint32);
+
+        if (Size > static_cast<uint32>(Payload.Num() - Offset))
+        {
+            return false;
+        }
+        OutText = PayloadToString(Payload.Slice(Offset, static_cast<int32>(Size)));
+        Offset += static_cast<int32>(Size);
+        return true;
+    }
+
+    inline void WriteRequest(TArray<uint8>& Payload, const FIGIGPTRequest& Request)
+    {
+        WriteString(Payload, Request.SystemPrompt);
+        WriteString(Payload, Request.UserPrompt);
+        WriteString(Payload, Request.AssistantPrompt);
+        WriteString(Payload, Request.Adapter.IsNone() ? FString() : Request.Adapter.ToString());
+    }
+
+    inline bool ReadRequest(TConstArrayView<uint8> Payload, FIGIGPTRequest& OutRequest)
+    {
+        int32 Offset{ 0 };
+        FString Adapter;
+        const bool bRead = ReadString(Payload, Offset, OutRequest.SystemPrompt)
+            && ReadString(Payload, Offset, OutRequest.UserPrompt)
+            && ReadString(Payload, Offset, OutRequest.AssistantPrompt)
+            && ReadString(Payload, Offset, Adapter);
+        OutRequest.Adapter = Adapter.IsEmpty() ? NAME_None : FName(*Adapter);
+        return bRead;
+    }
+}
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIGPTRemote.h"
+
+#include "Async/Async.h"
+#include "Common/TcpSocketBuilder.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+#include "IGIGPTProtocol.h"
+#include "IGILog.h"
+#include "IGISettings.h"
+
+#include <atomic>
+
+FIGIGPTRemote::FIGIGPTRemote(int32 InPort)
+    : Port(InPort)
+{
+}
+
+FIGIGPTRemote::~FIGIGPTRemote()
+{
+    FScopeLock Lock(&CS);
+    Disconnect();
+}
+
+bool FIGIGPTRemote::Connect()
+{
+    if (Socket != nullptr)
+    {
+        return true;
+    }
+
+    const FIPv4Endpoint Endpoint(FIPv4Address::InternalLoopback, static_cast<uint16>(Port));
+    Socket = FTcpSocketBuilder(TEXT("IGI GPT Client")).AsBlocking().WithSendBufferSize(64 * 1024).WithReceiveBufferSize(64 * 1024).Build();
+    if (Socket == nullptr || !Socket->Connect(*Endpoint.ToInternetAddr()))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to connect to the GPT server on %s"), ANSI_TO_TCHAR(__FUNCTION__), *Endpoint.ToString());
+        Disconnect();
+        return false;
+    }
+    Socket->SetNoDelay(true);
+
+    return true;
+}
+
+void FIGIGPTRemote::Disconnect()
+{
+    if (Socket != nullptr)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+}
+
+FString FIGIGPTRemote::EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
+{
+    using namespace IGIGPTProtocol;
+
+    FScopeLock Lock(&CS);
+
+    if (!Connect())
+    {
+        return FString();
+    }
+
+    TArray<uint8> Payload;
+    WriteRequest(Payload, Request);
+    if (!SendFrame(*Socket, EFrameType::Request, Payload))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: lost connection to the GPT server"), ANSI_TO_TCHAR(__FUNCTION__));
+        Disconnect();
+        return FString();
+    }
+
+    FString Response;
+    EFrameType Type;
+    while (ReceiveFrame(*Socket, Type, Payload))
+    {
+        if (Type == EFrameType::Token)
+        {
+            const FString Token = PayloadToString(Payload);
+            Response += Token;
+
+            // Closing the connection is how a request is cancelled
+            if (OnToken && !OnToken(Token))
+            {
+                Disconnect();
+                return Response;
+            }
+        }
+        else if (Type == EFrameType::Done)
+        {
+            return Response;
+        }
+        else
+        {
+            UE_LOG(LogIGISDK, Error, TEXT("%s: GPT server error: %s"), ANSI_TO_TCHAR(__FUNCTION__), *PayloadToString(Payload));
+            break;
+        }
+    }
+
+    Disconnect();
+    return Response;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand ServerLoadTestCommand(
+        TEXT("IGI.GPT.ServerLoadTest"),
+        TEXT("IGI.GPT.ServerLoadTest <NumClients> <NumRequestsPerClient>: simulates local clients of the GPT server and logs time to first token and throughput."),
+        FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+            {
+                const int32 NumClients = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8);
+                const int32 NumRequests = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 4);
+                const int32 Port = GetDefault<UIGISettings>()->GetServerPort();
+
+                // Runs off the game thread so the server can keep serving if it lives in this process
+                Async(EAsyncExecution::Thread, [NumClients, NumRequests, Port]()
+                    {
+                        std::atomic<int64> NumTokens{ 0 };
+                        std::atomic<int64> NumFailures{ 0 };
+                        std::atomic<int64> FirstTokenMicroseconds{ 0 };
+
+                        const double StartTime = FPlatformTime::Seconds();
+
+                        // One thread per simulated client, like separate processes would be
+                        TArray<TFuture<void>> Clients;
+                        for (int32 Client = 0; Client < NumClients; ++Client)
+                        {
+                            Clients.Add(Async(EAsyncExecution::Thread, [&, Client]()
+                                {
+                                    FIGIGPTRemote Remote(Port);
+                                    for (int32 i = 0; i < NumRequests; ++i)
+                                    {
+                                        const double RequestTime = FPlatformTime::Seconds();
+                                        bool bFirstToken{ true };
+
+                                        const FString Response = Remote.Evaluate({ FString(), FString::Printf(TEXT("Client %d, request %d: say hello."), Client, i), FString() },
+                                            [&](const FString& Token)
+                                            {
+                                                if (bFirstToken)
+                                                {
+                                                    FirstTokenMicroseconds += static_cast<int64>((FPlatformTime::Seconds() - RequestTime) * 1e6);
+                                                    bFirstToken = false;
+                                                }
+                                                ++NumTokens;
+                                                return true;
+                                            });
+
+                                        NumFailures += Response.IsEmpty() ? 1 : 0;
+                                    }
+                                }));
+                        }
+
+                        for (TFuture<void>& Client : Clients)
+                        {
+                            Client.Wait();
+                        }
+
+                        const double Duration = FPlatformTime::Seconds() - StartTime;
+                        const int64 NumTotal = static_cast<int64>(NumClients) * NumRequests;
+                        UE_LOG(LogIGISDK, Log, TEXT("IGI.GPT.ServerLoadTest: %d clients x %d requests in %.2f s, %lld failed, %.1f tokens/s, %.1f ms average time to first token"),
+                            NumClients, NumRequests, Duration, NumFailures.load(), NumTokens.load() / Duration,
+                            FirstTokenMicroseconds.load() / 1000.0 / FMath::Max<int64>(1, NumTotal - NumFailures.load()));
+                    });
+            }));
+}
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGIGPT.h"
+
+class FSocket;
+
+/** GPT whose model is hosted by an FIGIGPTServer in another local process */
+class FIGIGPTRemote : public FIGIGPT
+{
+public:
+    FIGIGPTRemote(int32 Port);
+    virtual ~FIGIGPTRemote();
+
+protected:
+    virtual FString EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken) override;
+
+private:
+    bool Connect();
+    void Disconnect();
+
+    FCriticalSection CS;
+    int32 Port;
+    FSocket* Socket{ nullptr };
+};
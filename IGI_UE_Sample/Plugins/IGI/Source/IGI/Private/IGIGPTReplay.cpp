@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIGPTReplay.h"
+
+#include "IGILog.h"
+
+namespace
+{
+    constexpr const TCHAR* const REPLAY_BACKEND_NAME{ TEXT("replay") };
+
+    // Waits shorter than this are not worth giving the thread up for
+    constexpr double MIN_SLEEP_SECONDS{ 0.0005 };
+
+    uint32 HashPrompt(const FIGIGPTRequest& Request)
+    {
+        uint32 Hash = GetTypeHash(Request.SystemPrompt);
+        Hash = HashCombineFast(Hash, GetTypeHash(Request.UserPrompt));
+        Hash = HashCombineFast(Hash, GetTypeHash(Request.AssistantPrompt));
+        return HashCombineFast(Hash, GetTypeHash(Request.Adapter));
+    }
+
+    bool IsSamePrompt(const FIGIGPTRequest& A, const FIGIGPTRequest& B)
+    {
+        return A.SystemPrompt == B.SystemPrompt && A.UserPrompt == B.UserPrompt && A.AssistantPrompt == B.AssistantPrompt && A.Adapter == B.Adapter;
+    }
+
+    void WaitUntil(double Seconds)
+    {
+        for (double Remaining = Seconds - FPlatformTime::Seconds(); Remaining > 0.0; Remaining = Seconds - FPlatformTime::Seconds())
+        {
+            if (Remaining > MIN_SLEEP_SECONDS)
+            {
+                FPlatformProcess::Sleep(static_cast<float>(Remaining - MIN_SLEEP_SECONDS));
+            }
+            else
+            {
+                FPlatformProcess::YieldThread();
+            }
+        }
+    }
+}
+
+FIGIGPTReplay::FIGIGPTReplay(const FString& TracePath, float InSpeed)
+    : Speed(FMath::Max(InSpeed, UE_KINDA_SMALL_NUMBER))
+{
+    FIGIGPTTraceRecorder::Load(TracePath, Records);
+    for (int32 Index = 0; Index < Records.Num(); ++Index)
+    {
+        RecordsByPrompt.Add(HashPrompt(Records[Index].Request), Index);
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: replaying %d requests from %s at %.2fx"), ANSI_TO_TCHAR(__FUNCTION__), Records.Num(), *TracePath, Speed);
+}
+
+const FIGIGPTTraceRecord* FIGIGPTReplay::FindRecord(const FIGIGPTRequest& Request)
+{
+    TArray<int32, TInlineAllocator<4>> Candidates;
+    RecordsByPrompt.MultiFind(HashPrompt(Request), Candidates, true);
+    for (const int32 Index : Candidates)
+    {
+        if (IsSamePrompt(Records[Index].Request, Request))
+        {
+            return &Records[Index];
+        }
+    }
+
+    if (Records.Num() == 0)
+    {
+        return nullptr;
+    }
+
+    const FIGIGPTTraceRecord* Record = &Records[NextRecord];
+    NextRecord = (NextRecord + 1) % Records.Num();
+    return Record;
+}
+
+FString FIGIGPTReplay::EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
+{
+    FScopeLock Lock(&CS);
+
+    const FIGIGPTTraceRecord* Record = FindRecord(Request);
+    if (Record == nullptr)
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: the trace has no requests"), ANSI_TO_TCHAR(__FUNCTION__));
+        return FString();
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    FString Response;
+    for (const FIGIGPTTraceRecord::FToken& Token : Record->Tokens)
+    {
+        WaitUntil(StartTime + Token.Milliseconds / (1000.0 * Speed));
+
+        Response += Token.Text;
+        if (OnToken && !OnToken(Token.Text))
+        {
+            return Response;
+        }
+    }
+
+    // The time the model took after its last token, to finish or to notice a cancellation
+    WaitUntil(StartTime + Record->TotalMilliseconds / (1000.0 * Speed));
+    return Response;
+}
+
+FString FIGIGPTReplay::GetModelGUID() const
+{
+    return Records.Num() > 0 ? Records[0].ModelGUID : FString();
+}
+
+FString FIGIGPTReplay::GetBackendName() const
+{
+    return REPLAY_BACKEND_NAME;
+}
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGIGPT.h"
+#include "IGIGPTTrace.h"
+
+/**
+ * GPT that plays back a trace recorded by FIGIGPTTraceRecorder instead of running a model, so that queueing, streaming and
+ * the delivery of responses to the game can be profiled with production timings on any machine. A request replays the
+ * recorded request with the same prompts and adapter, or the next record of the trace in order when there is none.
+ * Tokens arrive at their recorded times divided by the speed; one request is served at a time, as by the in-process host.
+ * Selected with -IGIReplayTrace=<path> [-IGIReplaySpeed=<speed>].
+ */
+class FIGIGPTReplay : public FIGIGPT
+{
+public:
+    FIGIGPTReplay(const FString& TracePath, float Speed);
+
+    virtual FString GetModelGUID() const override;
+    virtual FString GetBackendName() const override;
+
+protected:
+    virtual FString EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken) override;
+
+private:
+    const FIGIGPTTraceRecord* FindRecord(const FIGIGPTRequest& Request);
+
+    FCriticalSection CS;
+    TArray<FIGIGPTTraceRecord> Records;
+    TMultiMap<uint32, int32> RecordsByPrompt;
+    int32 NextRecord{ 0 };
+    float Speed{ 1.0f };
+};
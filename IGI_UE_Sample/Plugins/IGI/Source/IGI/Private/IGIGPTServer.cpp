@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIGPTServer.h"
+
+#include "Common/TcpListener.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+#include "IGIGPT.h"
+#include "IGIGPTProtocol.h"
+#include "IGILog.h"
+
+#include <atomic>
+
+class FIGIGPTServer::FConnection : public FRunnable
+{
+public:
+    FConnection(FIGIGPT& InGPT, FSocket* InSocket, const FString& InName)
+        : GPT(InGPT)
+        , Socket(InSocket)
+        , Name(InName)
+    {
+        Socket->SetNonBlocking(false);
+        Socket->SetNoDelay(true);
+        Thread.Reset(FRunnableThread::Create(this, *FString::Printf(TEXT("IGI GPT Server %s"), *Name)));
+    }
+
+    virtual ~FConnection()
+    {
+        Stop();
+        Thread.Reset();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+    }
+
+    virtual uint32 Run() override
+    {
+        using namespace IGIGPTProtocol;
+
+        UE_LOG(LogIGISDK, Log, TEXT("%s: client %s connected"), ANSI_TO_TCHAR(__FUNCTION__), *Name);
+
+        EFrameType Type;
+        TArray<uint8> Payload;
+        while (ReceiveFrame(*Socket, Type, Payload))
+        {
+            FIGIGPTRequest Request;
+            if (Type != EFrameType::Request || !ReadRequest(Payload, Request))
+            {
+                SendTextFrame(*Socket, EFrameType::Error, TEXT("Malformed request"));
+                break;
+            }
+
+            // Tokens are relayed as they are generated; a failed send means the client went away, which cancels the request
+            bool bConnected{ true };
+            GPT.Evaluate(Request, [this, &bConnected](const FString& Token)
+                {
+                    bConnected = SendTextFrame(*Socket, EFrameType::Token, Token);
+                    return bConnected;
+                });
+
+            if (!bConnected || !SendFrame(*Socket, EFrameType::Done, {}))
+            {
+                break;
+            }
+        }
+
+        UE_LOG(LogIGISDK, Log, TEXT("%s: client %s disconnected"), ANSI_TO_TCHAR(__FUNCTION__), *Name);
+
+        bFinished = true;
+        return 0;
+    }
+
+    virtual void Stop() override
+    {
+        // Unblocks any pending Recv/Send
+        Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+    }
+
+    bool IsFinished() const { return bFinished; }
+
+private:
+    FIGIGPT& GPT;
+    FSocket* Socket;
+    FString Name;
+    TUniquePtr<FRunnableThread> Thread;
+    std::atomic<bool> bFinished{ false };
+};
+
+// ----------------------------------
+
+FIGIGPTServer::FIGIGPTServer(FIGIGPT& InGPT, int32 Port)
+    : GPT(InGPT)
+{
+    // Loopback only: the server is meant for processes on the same machine
+    const FIPv4Endpoint Endpoint(FIPv4Address::InternalLoopback, static_cast<uint16>(Port));
+    Listener = MakeUnique<FTcpListener>(Endpoint, FTimespan::FromMilliseconds(100), false);
+    Listener->OnConnectionAccepted().BindRaw(this, &FIGIGPTServer::OnConnectionAccepted);
+
+    UE_LOG(LogIGISDK, Log, TEXT("IGI: GPT server listening on %s"), *Endpoint.ToString());
+}
+
+FIGIGPTServer::~FIGIGPTServer()
+{
+    // Stop accepting before tearing down the connections
+    Listener.Reset();
+
+    FScopeLock Lock(&ConnectionsCS);
+    Connections.Reset();
+}
+
+bool FIGIGPTServer::IsListening() const
+{
+    return Listener.IsValid() && Listener->IsActive();
+}
+
+bool FIGIGPTServer::OnConnectionAccepted(FSocket* Socket, const FIPv4Endpoint& Endpoint)
+{
+    FScopeLock Lock(&ConnectionsCS);
+
+    Connections.RemoveAll([](const TUniquePtr<FConnection>& Connection)
+        {
+            return Connection->IsFinished();
+        });
+
+    Connections.Add(MakeUnique<FConnection>(GPT, Socket, Endpoint.ToString()));
+    return true;
+}
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FIGIGPT;
+class FSocket;
+class FTcpListener;
+struct FIPv4Endpoint;
+
+/**
+ * Serves a GPT hosted in this process to other local processes over the loopback interface (see IGIGPTProtocol.h).
+ * Each connection gets its own thread; requests from all connections are serialized by the GPT itself.
+ */
+class FIGIGPTServer
+{
+public:
+    FIGIGPTServer(FIGIGPT& GPT, int32 Port);
+    virtual ~FIGIGPTServer();
+
+    bool IsListening() const;
+
+private:
+    class FConnection;
+
+    bool OnConnectionAccepted(FSocket* Socket, const FIPv4Endpoint& Endpoint);
+
+    // Non-owning ref
+    FIGIGPT& GPT;
+
+    TUniquePtr<FTcpListener> Listener;
+
+    FCriticalSection ConnectionsCS;
+    TArray<TUniquePtr<FConnection>> Connections;
+};
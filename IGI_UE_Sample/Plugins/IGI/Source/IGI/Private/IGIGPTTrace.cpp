@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIGPTTrace.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+#include "IGILog.h"
+
+namespace
+{
+    constexpr uint32 TRACE_MAGIC{ 0x54494749 }; // "IGIT"
+    constexpr uint32 TRACE_VERSION{ 1 };
+
+    constexpr const TCHAR* const TRACE_EXTENSION{ TEXT(".igitrace") };
+
+    FCriticalSection ActiveRecorderCS;
+    TSharedPtr<FIGIGPTTraceRecorder, ESPMode::ThreadSafe> ActiveRecorder;
+
+    void SerializeRecord(FArchive& Ar, FIGIGPTTraceRecord& Record)
+    {
+        // Plain archives do not serialize names
+        FString Adapter = Record.Request.Adapter.IsNone() ? FString() : Record.Request.Adapter.ToString();
+
+        Ar << Record.StartSeconds;
+        Ar << Record.Request.SystemPrompt;
+        Ar << Record.Request.UserPrompt;
+        Ar << Record.Request.AssistantPrompt;
+        Ar << Adapter;
+        Ar << Record.Request.Seed;
+        Ar << Record.ModelGUID;
+        Ar << Record.Backend;
+        Ar << Record.MaxTokensToPredict;
+
+        int32 NumTokens = Record.Tokens.Num();
+        Ar << NumTokens;
+        if (Ar.IsLoading())
+        {
+            if (NumTokens < 0 || NumTokens > Ar.TotalSize() - Ar.Tell())
+            {
+                Ar.SetError();
+                return;
+            }
+            Record.Tokens.SetNum(NumTokens);
+            Record.Request.Adapter = Adapter.IsEmpty() ? NAME_None : FName(*Adapter);
+        }
+        for (FIGIGPTTraceRecord::FToken& Token : Record.Tokens)
+        {
+            Ar << Token.Milliseconds;
+            Ar << Token.Text;
+        }
+
+        Ar << Record.TotalMilliseconds;
+        Ar << Record.bCancelled;
+    }
+}
+
+FIGIGPTTraceRecorder::FIGIGPTTraceRecorder(TUniquePtr<FArchive>&& InWriter, FString&& InPath)
+    : Writer(MoveTemp(InWriter))
+    , Path(MoveTemp(InPath))
+    , StartSeconds(FPlatformTime::Seconds())
+{
+    uint32 Magic{ TRACE_MAGIC };
+    uint32 Version{ TRACE_VERSION };
+    *Writer << Magic;
+    *Writer << Version;
+}
+
+FIGIGPTTraceRecorder::~FIGIGPTTraceRecorder()
+{
+    Writer->Close();
+    UE_LOG(LogIGISDK, Log, TEXT("%s: recorded %d requests to %s"), ANSI_TO_TCHAR(__FUNCTION__), NumRecords, *Path);
+}
+
+TSharedPtr<FIGIGPTTraceRecorder, ESPMode::ThreadSafe> FIGIGPTTraceRecorder::GetActive()
+{
+    FScopeLock Lock(&ActiveRecorderCS);
+    return ActiveRecorder;
+}
+
+bool FIGIGPTTraceRecorder::Start(const FString& InPath)
+{
+    FString Path = InPath;
+    if (Path.IsEmpty())
+    {
+        Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("IGI"), TEXT("Traces"), FDateTime::Now().ToString() + TRACE_EXTENSION);
+    }
+
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path));
+    if (!Writer.IsValid())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to create %s"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+        return false;
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: recording GPT requests to %s"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+
+    // Requests in flight keep the previous recorder alive until they are written
+    FScopeLock Lock(&ActiveRecorderCS);
+    ActiveRecorder = MakeShared<FIGIGPTTraceRecorder, ESPMode::ThreadSafe>(MoveTemp(Writer), MoveTemp(Path));
+    return true;
+}
+
+void FIGIGPTTraceRecorder::Stop()
+{
+    FScopeLock Lock(&ActiveRecorderCS);
+    ActiveRecorder.Reset();
+}
+
+double FIGIGPTTraceRecorder::GetSeconds() const
+{
+    return FPlatformTime::Seconds() - StartSeconds;
+}
+
+void FIGIGPTTraceRecorder::Write(FIGIGPTTraceRecord& Record)
+{
+    FScopeLock Lock(&CS);
+    SerializeRecord(*Writer, Record);
+    Writer->Flush();
+    ++NumRecords;
+}
+
+bool FIGIGPTTraceRecorder::Load(const FString& Path, TArray<FIGIGPTTraceRecord>& OutRecords)
+{
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+    if (!Reader.IsValid())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to open %s"), ANSI_TO_TCHAR(__FUNCTION__), *Path);
+        return false;
+    }
+
+    uint32 Magic{ 0 };
+    uint32 Version{ 0 };
+    *Reader << Magic;
+    *Reader << Version;
+    if (Reader->IsError() || Magic != TRACE_MAGIC || Version != TRACE_VERSION)
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: %s is not a GPT trace of version %u"), ANSI_TO_TCHAR(__FUNCTION__), *Path, TRACE_VERSION);
+        return false;
+    }
+
+    // A trace cut short by a crash ends with a partial record, which is dropped
+    OutRecords.Reset();
+    while (Reader->Tell() < Reader->TotalSize())
+    {
+        FIGIGPTTraceRecord Record;
+        SerializeRecord(*Reader, Record);
+        if (Reader->IsError())
+        {
+            break;
+        }
+        OutRecords.Add(MoveTemp(Record));
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: %d requests in %s"), ANSI_TO_TCHAR(__FUNCTION__), OutRecords.Num(), *Path);
+    return true;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand TraceStartCommand(
+        TEXT("IGI.Trace.Start"),
+        TEXT("IGI.Trace.Start [Path]: records the prompts, parameters and token timings of every GPT request, to Saved/IGI/Traces by default."),
+        FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+            {
+                FIGIGPTTraceRecorder::Start(Args.Num() > 0 ? Args[0] : FString());
+            }));
+
+    FAutoConsoleCommand TraceStopCommand(
+        TEXT("IGI.Trace.Stop"),
+        TEXT("Stops recording GPT requests."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                FIGIGPTTraceRecorder::Stop();
+            }));
+}
@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGIGPT.h"
+
+/** One evaluated request of a trace, with the time every token arrived at */
+struct FIGIGPTTraceRecord
+{
+    struct FToken
+    {
+        /** Since the request started, in ms */
+        float Milliseconds{ 0.0f };
+        FString Text;
+    };
+
+    /** Since the trace started, in s */
+    double StartSeconds{ 0.0 };
+
+    FIGIGPTRequest Request;
+    FString ModelGUID;
+    FString Backend;
+    int32 MaxTokensToPredict{ 0 };
+
+    TArray<FToken> Tokens;
+
+    /** Until Evaluate returned, in ms */
+    float TotalMilliseconds{ 0.0f };
+
+    /** Whether the caller cancelled the request from its token callback */
+    bool bCancelled{ false };
+};
+
+/**
+ * Records every request FIGIGPT::Evaluate serves, whatever hosts the model, to a binary trace: prompts, adapter, seed,
+ * model, backend and the arrival time of each token. FIGIGPTReplay plays traces back without a model.
+ * Started with -IGITrace[=<path>] or IGI.Trace.Start, stopped with IGI.Trace.Stop; traces go to Saved/IGI/Traces by default.
+ */
+class FIGIGPTTraceRecorder
+{
+public:
+    /** Recorder of the trace being recorded; null when none is */
+    static TSharedPtr<FIGIGPTTraceRecorder, ESPMode::ThreadSafe> GetActive();
+
+    /** Starts recording to Path, or to a new file in Saved/IGI/Traces when empty; stops any trace being recorded */
+    static bool Start(const FString& Path);
+    static void Stop();
+
+    /** Reads a trace; false when the file is missing or not a trace of this version */
+    static bool Load(const FString& Path, TArray<FIGIGPTTraceRecord>& OutRecords);
+
+    FIGIGPTTraceRecorder(TUniquePtr<FArchive>&& Writer, FString&& Path);
+    ~FIGIGPTTraceRecorder();
+
+    /** Seconds since the trace started */
+    double GetSeconds() const;
+
+    /** Appends a record, and flushes it so that a trace survives a crash up to its last complete request */
+    void Write(FIGIGPTTraceRecord& Record);
+
+    const FString& GetPath() const { return Path; }
+
+private:
+    FCriticalSection CS;
+    TUniquePtr<FArchive> Writer;
+    FString Path;
+    double StartSeconds{ 0.0 };
+    int32 NumRecords{ 0 };
+};
@@ -0,0 +1,592 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIGPTWorker.h"
+
+#include "Async/Async.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+#include "IGILog.h"
+
+namespace
+{
+    constexpr uint32 WORKER_CHANNEL_MAGIC{ 0x49474957 }; // 'IGIW'
+    constexpr uint64 REQUEST_RING_CAPACITY{ 1024 * 1024 };
+    constexpr uint64 RESPONSE_RING_CAPACITY{ 1024 * 1024 };
+
+    // Loading the model in a fresh process takes a while
+    constexpr double WORKER_READY_TIMEOUT_SECONDS{ 300.0 };
+
+    // Give up relaunching a worker that keeps dying, e.g. when the model cannot be loaded at all
+    constexpr int32 MAX_CONSECUTIVE_FAILED_LAUNCHES{ 3 };
+
+    // Spinning this many times before sleeping keeps back-to-back tokens in the microsecond range
+    constexpr int32 SPIN_COUNT_BEFORE_SLEEP{ 4096 };
+    constexpr float IDLE_SLEEP_SECONDS{ 0.0005f };
+
+    constexpr double PARENT_CHECK_INTERVAL_SECONDS{ 1.0 };
+
+    enum class EMessageType : uint8
+    {
+        Request = 1,
+        Token = 2,
+        Done = 3,
+    };
+
+    struct FMessageHeader
+    {
+        uint32 RequestId;
+        EMessageType Type;
+        uint8 Padding[3];
+    };
+
+    struct FBackoff
+    {
+        int32 NumWaits{ 0 };
+
+        void Wait()
+        {
+            if (++NumWaits < SPIN_COUNT_BEFORE_SLEEP)
+            {
+                FPlatformProcess::YieldThread();
+            }
+            else
+            {
+                FPlatformProcess::SleepNoStats(IDLE_SLEEP_SECONDS);
+            }
+        }
+    };
+
+    int32 GetUTF8Length(const FString& Text)
+    {
+        return FPlatformString::ConvertedLength<UTF8CHAR>(*Text, Text.Len());
+    }
+
+    uint64 GetMessageSize(std::initializer_list<const FString*> Strings)
+    {
+        const bool bLengthPrefixed = Strings.size() > 1;
+
+        uint64 PayloadSize = sizeof(FMessageHeader);
+        for (const FString* Text : Strings)
+        {
+            PayloadSize += GetUTF8Length(*Text) + (bLengthPrefixed ? sizeof(uint32) : 0);
+        }
+        return PayloadSize;
+    }
+
+    /**
+     * Encodes the strings straight into the ring, each prefixed with its length when there are several. Returns false while
+     * the ring is too full, and always for messages over GetMaxPayloadSize, which callers must reject beforehand.
+     */
+    bool TryWriteMessage(FIGISharedRingBuffer& Ring, uint32 RequestId, EMessageType Type, std::initializer_list<const FString*> Strings)
+    {
+        const bool bLengthPrefixed = Strings.size() > 1;
+
+        const uint64 PayloadSize = GetMessageSize(Strings);
+        if (PayloadSize > Ring.GetMaxPayloadSize())
+        {
+            return false;
+        }
+
+        uint8* Payload = Ring.BeginWrite(static_cast<uint32>(PayloadSize));
+        if (Payload == nullptr)
+        {
+            return false;
+        }
+
+        *reinterpret_cast<FMessageHeader*>(Payload) = { RequestId, Type, {} };
+        uint8* Cursor = Payload + sizeof(FMessageHeader);
+        for (const FString* Text : Strings)
+        {
+            const uint32 Length = GetUTF8Length(*Text);
+            if (bLengthPrefixed)
+            {
+                FMemory::Memcpy(Cursor, &Length, sizeof(uint32));
+                Cursor += sizeof(uint32);
+            }
+            FPlatformString::Convert(reinterpret_cast<UTF8CHAR*>(Cursor), Length, **Text, Text->Len());
+            Cursor += Length;
+        }
+
+        Ring.EndWrite();
+        return true;
+    }
+
+    FString ReadText(TConstArrayView<uint8> Payload, int32& Offset, bool bLengthPrefixed)
+    {
+        uint32 Length = Payload.Num() - Offset;
+        if (bLengthPrefixed)
+        {
+            FMemory::Memcpy(&Length, Payload.GetData() + Offset, sizeof(uint32));
+            Offset += sizeof(uint32);
+        }
+        FString Text(static_cast<int32>(Length), reinterpret_cast<const UTF8CHAR*>(Payload.GetData() + Offset));
+        Offset += static_cast<int32>(Length);
+        return Text;
+    }
+
+    uint64 GetChannelSize()
+    {
+        return Align(sizeof(FIGIGPTWorkerChannel::FControl), PLATFORM_CACHE_LINE_SIZE)
+            + FIGISharedRingBuffer::GetRequiredSize(REQUEST_RING_CAPACITY)
+            + FIGISharedRingBuffer::GetRequiredSize(RESPONSE_RING_CAPACITY);
+    }
+}
+
+// ----------------------------------
+
+FIGIGPTWorkerChannel::~FIGIGPTWorkerChannel()
+{
+    if (Region != nullptr)
+    {
+        FPlatformMemory::UnmapNamedSharedMemoryRegion(Region);
+    }
+    if (LocalMemory != nullptr)
+    {
+        FMemory::Free(LocalMemory);
+    }
+}
+
+bool FIGIGPTWorkerChannel::Create(const FString& RegionName)
+{
+    const uint32 Access = static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Read) | static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Write);
+    Region = FPlatformMemory::MapNamedSharedMemoryRegion(RegionName, true, Access, GetChannelSize());
+    if (Region == nullptr)
+    {
+        return false;
+    }
+
+    Layout(Region->GetAddress(), true);
+    return true;
+}
+
+bool FIGIGPTWorkerChannel::Open(const FString& RegionName)
+{
+    const uint32 Access = static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Read) | static_cast<uint32>(FPlatformMemory::ESharedMemoryAccess::Write);
+    Region = FPlatformMemory::MapNamedSharedMemoryRegion(RegionName, false, Access, GetChannelSize());
+    if (Region == nullptr)
+    {
+        return false;
+    }
+
+    Layout(Region->GetAddress(), false);
+    return Control->Magic == WORKER_CHANNEL_MAGIC;
+}
+
+void FIGIGPTWorkerChannel::CreateLocal()
+{
+    LocalMemory = FMemory::Malloc(GetChannelSize(), PLATFORM_CACHE_LINE_SIZE);
+    Layout(LocalMemory, true);
+}
+
+void FIGIGPTWorkerChannel::Layout(void* Memory, bool bInitialize)
+{
+    uint8* Cursor = static_cast<uint8*>(Memory);
+
+    Control = bInitialize ? new (Cursor) FControl() : reinterpret_cast<FControl*>(Cursor);
+    Cursor += Align(sizeof(FControl), PLATFORM_CACHE_LINE_SIZE);
+
+    if (bInitialize)
+    {
+        Requests.Initialize(Cursor, REQUEST_RING_CAPACITY);
+        Responses.Initialize(Cursor + FIGISharedRingBuffer::GetRequiredSize(REQUEST_RING_CAPACITY), RESPONSE_RING_CAPACITY);
+        Control->Magic = WORKER_CHANNEL_MAGIC;
+    }
+    else
+    {
+        Requests.Attach(Cursor, REQUEST_RING_CAPACITY);
+        Responses.Attach(Cursor + FIGISharedRingBuffer::GetRequiredSize(REQUEST_RING_CAPACITY), RESPONSE_RING_CAPACITY);
+    }
+}
+
+// ----------------------------------
+
+FIGIGPTWorkerClient::FIGIGPTWorkerClient()
+{
+}
+
+FIGIGPTWorkerClient::~FIGIGPTWorkerClient()
+{
+    FScopeLock Lock(&CS);
+    StopWorker();
+}
+
+void FIGIGPTWorkerClient::StopWorker()
+{
+    if (WorkerProcess.IsValid())
+    {
+        FPlatformProcess::TerminateProc(WorkerProcess, true);
+        FPlatformProcess::CloseProc(WorkerProcess);
+    }
+    Channel.Reset();
+}
+
+bool FIGIGPTWorkerClient::EnsureWorker()
+{
+    if (WorkerProcess.IsValid() && FPlatformProcess::IsProcRunning(WorkerProcess))
+    {
+        return true;
+    }
+
+    if (WorkerProcess.IsValid())
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: inference worker exited; relaunching"), ANSI_TO_TCHAR(__FUNCTION__));
+        StopWorker();
+    }
+
+    if (NumFailedLaunches >= MAX_CONSECUTIVE_FAILED_LAUNCHES)
+    {
+        return false;
+    }
+
+    // A fresh region per launch, so nothing a dead worker left behind can be misread
+    const uint32 ProcessId = FPlatformProcess::GetCurrentProcessId();
+    const FString RegionName = FString::Printf(TEXT("IGIWorker_%u_%d"), ProcessId, Generation++);
+
+    Channel = MakeUnique<FIGIGPTWorkerChannel>();
+    if (!Channel->Create(RegionName))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to create shared memory region %s"), ANSI_TO_TCHAR(__FUNCTION__), *RegionName);
+        Channel.Reset();
+        ++NumFailedLaunches;
+        return false;
+    }
+
+    // The worker is this same executable, running headless
+    FString Params;
+    if (GIsEditor)
+    {
+        Params = FString::Printf(TEXT("\"%s\" -game "), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()));
+    }
+    Params += FString::Printf(TEXT("-nullrhi -nosound -nosplash -unattended -IGIWorker=%s -IGIParentPid=%u"), *RegionName, ProcessId);
+
+    WorkerProcess = FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *Params, false, true, true, nullptr, 0, nullptr, nullptr);
+    if (!WorkerProcess.IsValid())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to launch inference worker"), ANSI_TO_TCHAR(__FUNCTION__));
+        Channel.Reset();
+        ++NumFailedLaunches;
+        return false;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    while (Channel->Control->bWorkerReady.load(std::memory_order_acquire) == 0)
+    {
+        if (!FPlatformProcess::IsProcRunning(WorkerProcess) || FPlatformTime::Seconds() - StartTime > WORKER_READY_TIMEOUT_SECONDS)
+        {
+            UE_LOG(LogIGISDK, Error, TEXT("%s: inference worker failed to start (attempt %d of %d)"), ANSI_TO_TCHAR(__FUNCTION__),
+                NumFailedLaunches + 1, MAX_CONSECUTIVE_FAILED_LAUNCHES);
+            StopWorker();
+            ++NumFailedLaunches;
+            return false;
+        }
+        FPlatformProcess::SleepNoStats(0.01f);
+    }
+
+    UE_LOG(LogIGISDK, Log, TEXT("%s: inference worker ready after %.1f s"), ANSI_TO_TCHAR(__FUNCTION__), FPlatformTime::Seconds() - StartTime);
+    return true;
+}
+
+FString FIGIGPTWorkerClient::EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken)
+{
+    FScopeLock Lock(&CS);
+
+    if (!EnsureWorker())
+    {
+        return FString();
+    }
+
+    const uint32 RequestId = ++NextRequestId;
+
+    const FString Adapter = Request.Adapter.IsNone() ? FString() : Request.Adapter.ToString();
+
+    // Would never fit in the ring, however long it waited
+    const uint64 RequestSize = GetMessageSize({ &Request.SystemPrompt, &Request.UserPrompt, &Request.AssistantPrompt, &Adapter });
+    if (RequestSize > Channel->Requests.GetMaxPayloadSize())
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: request of %llu bytes is larger than the %llu the inference worker takes"), ANSI_TO_TCHAR(__FUNCTION__),
+            RequestSize, Channel->Requests.GetMaxPayloadSize());
+        return FString();
+    }
+
+    FBackoff Backoff;
+    while (!TryWriteMessage(Channel->Requests, RequestId, EMessageType::Request, { &Request.SystemPrompt, &Request.UserPrompt, &Request.AssistantPrompt, &Adapter }))
+    {
+        if (!FPlatformProcess::IsProcRunning(WorkerProcess))
+        {
+            return FString();
+        }
+        Backoff.Wait();
+    }
+
+    FString Response;
+    Backoff = {};
+    while (true)
+    {
+        TConstArrayView<uint8> Payload;
+        if (!Channel->Responses.BeginRead(Payload))
+        {
+            if (!FPlatformProcess::IsProcRunning(WorkerProcess))
+            {
+                UE_LOG(LogIGISDK, Error, TEXT("%s: inference worker exited during a request"), ANSI_TO_TCHAR(__FUNCTION__));
+                ++NumFailedLaunches;
+                StopWorker();
+                return Response;
+            }
+            Backoff.Wait();
+            continue;
+        }
+        Backoff = {};
+
+        const FMessageHeader Header = *reinterpret_cast<const FMessageHeader*>(Payload.GetData());
+
+        // Leftovers of a cancelled request
+        if (Header.RequestId != RequestId)
+        {
+            Channel->Responses.EndRead();
+            continue;
+        }
+
+        if (Header.Type == EMessageType::Done)
+        {
+            Channel->Responses.EndRead();
+            NumFailedLaunches = 0;
+            return Response;
+        }
+
+        int32 Offset = sizeof(FMessageHeader);
+        const FString Token = ReadText(Payload, Offset, false);
+        Channel->Responses.EndRead();
+
+        Response += Token;
+        if (OnToken && !OnToken(Token))
+        {
+            Channel->Control->CancelRequestId.store(RequestId, std::memory_order_release);
+            return Response;
+        }
+    }
+}
+
+// ----------------------------------
+
+FIGIGPTWorkerHost::FIGIGPTWorkerHost(FIGIGPT& InGPT, const FString& RegionName, uint32 ParentProcessId)
+    : GPT(InGPT)
+{
+    ParentProcess = FPlatformProcess::OpenProcess(ParentProcessId);
+
+    if (!Channel.Open(RegionName))
+    {
+        UE_LOG(LogIGISDK, Error, TEXT("%s: unable to open shared memory region %s"), ANSI_TO_TCHAR(__FUNCTION__), *RegionName);
+        return;
+    }
+
+    Thread.Reset(FRunnableThread::Create(this, TEXT("IGI GPT Worker Host")));
+}
+
+FIGIGPTWorkerHost::~FIGIGPTWorkerHost()
+{
+    Stop();
+    Thread.Reset();
+
+    if (ParentProcess.IsValid())
+    {
+        FPlatformProcess::CloseProc(ParentProcess);
+    }
+}
+
+bool FIGIGPTWorkerHost::IsWorkerProcess(FString* OutRegionName, uint32* OutParentProcessId)
+{
+    FString RegionName;
+    uint32 ParentProcessId{ 0 };
+    const bool bIsWorker = FParse::Value(FCommandLine::Get(), TEXT("IGIWorker="), RegionName) && FParse::Value(FCommandLine::Get(), TEXT("IGIParentPid="), ParentProcessId);
+
+    if (OutRegionName)
+    {
+        *OutRegionName = RegionName;
+    }
+    if (OutParentProcessId)
+    {
+        *OutParentProcessId = ParentProcessId;
+    }
+    return bIsWorker;
+}
+
+uint32 FIGIGPTWorkerHost::Run()
+{
+    // The model is loaded by the time the host exists
+    Channel.Control->bWorkerReady.store(1, std::memory_order_release);
+
+    FBackoff Backoff;
+    LastParentCheckSeconds = FPlatformTime::Seconds();
+
+    while (!bStopping)
+    {
+        TConstArrayView<uint8> Payload;
+        if (!Channel.Requests.BeginRead(Payload))
+        {
+            if (!CheckParentProcess())
+            {
+                break;
+            }
+
+            Backoff.Wait();
+            continue;
+        }
+        Backoff = {};
+
+        const FMessageHeader Header = *reinterpret_cast<const FMessageHeader*>(Payload.GetData());
+        int32 Offset = sizeof(FMessageHeader);
+
+        FIGIGPTRequest Request;
+        Request.SystemPrompt = ReadText(Payload, Offset, true);
+        Request.UserPrompt = ReadText(Payload, Offset, true);
+        Request.AssistantPrompt = ReadText(Payload, Offset, true);
+        const FString Adapter = ReadText(Payload, Offset, true);
+        Request.Adapter = Adapter.IsEmpty() ? NAME_None : FName(*Adapter);
+        Channel.Requests.EndRead();
+
+        const uint32 RequestId = Header.RequestId;
+        GPT.Evaluate(Request, [this, RequestId](const FString& Token)
+            {
+                if (Channel.Control->CancelRequestId.load(std::memory_order_acquire) == RequestId || bStopping)
+                {
+                    return false;
+                }
+
+                if (GetMessageSize({ &Token }) > Channel.Responses.GetMaxPayloadSize())
+                {
+                    UE_LOG(LogIGISDK, Error, TEXT("%s: token of %d characters does not fit in the response ring; cancelling the request"), ANSI_TO_TCHAR(__FUNCTION__), Token.Len());
+                    return false;
+                }
+
+                // The game stops reading when it exits
+                FBackoff WriteBackoff;
+                while (!TryWriteMessage(Channel.Responses, RequestId, EMessageType::Token, { &Token }))
+                {
+                    if (bStopping || !CheckParentProcess())
+                    {
+                        return false;
+                    }
+                    WriteBackoff.Wait();
+                }
+                return true;
+            });
+
+        FBackoff WriteBackoff;
+        while (!bStopping && CheckParentProcess() && !TryWriteMessage(Channel.Responses, RequestId, EMessageType::Done, {}))
+        {
+            WriteBackoff.Wait();
+        }
+    }
+
+    return 0;
+}
+
+bool FIGIGPTWorkerHost::CheckParentProcess()
+{
+    if (bStopping)
+    {
+        return false;
+    }
+    if (FPlatformTime::Seconds() - LastParentCheckSeconds < PARENT_CHECK_INTERVAL_SECONDS)
+    {
+        return true;
+    }
+    LastParentCheckSeconds = FPlatformTime::Seconds();
+
+    if (ParentProcess.IsValid() && FPlatformProcess::IsProcRunning(ParentProcess))
+    {
+        return true;
+    }
+
+    // A worker outliving its game would hold on to the model forever
+    if (!bStopping.exchange(true))
+    {
+        UE_LOG(LogIGISDK, Log, TEXT("%s: game process exited; shutting down the inference worker"), ANSI_TO_TCHAR(__FUNCTION__));
+        AsyncTask(ENamedThreads::GameThread, []()
+            {
+                RequestEngineExit(TEXT("IGI inference worker orphaned"));
+            });
+    }
+    return false;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand WorkerTransportBenchCommand(
+        TEXT("IGI.GPT.WorkerTransportBench"),
+        TEXT("IGI.GPT.WorkerTransportBench <NumMessages>: measures the inference worker transport by bouncing token-sized messages between two threads over an in-process channel."),
+        FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+            {
+                const int32 NumMessages = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000);
+
+                FIGIGPTWorkerChannel Channel;
+                Channel.CreateLocal();
+
+                // Echoes every message back until it receives Done
+                TFuture<void> Echo = Async(EAsyncExecution::Thread, [&Channel]()
+                    {
+                        FBackoff Backoff;
+                        while (true)
+                        {
+                            TConstArrayView<uint8> Payload;
+                            if (!Channel.Requests.BeginRead(Payload))
+                            {
+                                Backoff.Wait();
+                                continue;
+                            }
+                            Backoff = {};
+
+                            const FMessageHeader Header = *reinterpret_cast<const FMessageHeader*>(Payload.GetData());
+                            int32 Offset = sizeof(FMessageHeader);
+                            const FString Token = ReadText(Payload, Offset, false);
+                            Channel.Requests.EndRead();
+
+                            if (Header.Type == EMessageType::Done)
+                            {
+                                return;
+                            }
+                            while (!TryWriteMessage(Channel.Responses, Header.RequestId, EMessageType::Token, { &Token }))
+                            {
+                                Backoff.Wait();
+                            }
+                        }
+                    });
+
+                const FString Token(TEXT(" tavern"));
+                const double StartTime = FPlatformTime::Seconds();
+
+                for (int32 i = 0; i < NumMessages; ++i)
+                {
+                    FBackoff Backoff;
+                    while (!TryWriteMessage(Channel.Requests, static_cast<uint32>(i), EMessageType::Token, { &Token }))
+                    {
+                        Backoff.Wait();
+                    }
+
+                    TConstArrayView<uint8> Payload;
+                    while (!Channel.Responses.BeginRead(Payload))
+                    {
+                        Backoff.Wait();
+                    }
+                    int32 Offset = sizeof(FMessageHeader);
+                    ReadText(Payload, Offset, false);
+                    Channel.Responses.EndRead();
+                }
+
+                const double Duration = FPlatformTime::Seconds() - StartTime;
+                TryWriteMessage(Channel.Requests, 0, EMessageType::Done, {});
+                Echo.Wait();
+
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.GPT.WorkerTransportBench: %d round trips in %.3f s, %.2f us per round trip, %.2f us per token one way"),
+                    NumMessages, Duration, Duration * 1e6 / NumMessages, Duration * 0.5e6 / NumMessages);
+            }));
+}
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Runnable.h"
+
+#include "IGIGPT.h"
+#include "IGISharedRingBuffer.h"
+
+#include <atomic>
+
+class FRunnableThread;
+
+/**
+ * Shared-memory channel between the game process and its inference worker process: a small control block followed by
+ * a request ring (game -> worker) and a response ring (worker -> game).
+ */
+class FIGIGPTWorkerChannel
+{
+public:
+    ~FIGIGPTWorkerChannel();
+
+    /** Game side: creates and lays out a new region */
+    bool Create(const FString& RegionName);
+
+    /** Worker side: maps the region created by the game */
+    bool Open(const FString& RegionName);
+
+    /** In-process channel over plain memory, to measure the transport */
+    void CreateLocal();
+
+    struct FControl
+    {
+        uint32 Magic{ 0 };
+        std::atomic<uint32> bWorkerReady{ 0 };
+        std::atomic<uint32> CancelRequestId{ 0 };
+    };
+
+    FControl* Control{ nullptr };
+    FIGISharedRingBuffer Requests;
+    FIGISharedRingBuffer Responses;
+
+private:
+    void Layout(void* Memory, bool bInitialize);
+
+    FPlatformMemory::FSharedMemoryRegion* Region{ nullptr };
+    void* LocalMemory{ nullptr };
+};
+
+/**
+ * GPT hosted by a child worker process. A crash or fatal error in nvigi, CUDA or the model only takes down the worker,
+ * which is relaunched on the next request; the model's working set does not count against the game's address space.
+ */
+class FIGIGPTWorkerClient : public FIGIGPT
+{
+public:
+    FIGIGPTWorkerClient();
+    virtual ~FIGIGPTWorkerClient();
+
+protected:
+    virtual FString EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken) override;
+
+private:
+    bool EnsureWorker();
+    void StopWorker();
+
+    FCriticalSection CS;
+    TUniquePtr<FIGIGPTWorkerChannel> Channel;
+    FProcHandle WorkerProcess;
+    uint32 NextRequestId{ 0 };
+    int32 Generation{ 0 };
+    int32 NumFailedLaunches{ 0 };
+};
+
+/** Worker process side: serves requests from the channel with a GPT hosted in the worker */
+class FIGIGPTWorkerHost : public FRunnable
+{
+public:
+    FIGIGPTWorkerHost(FIGIGPT& GPT, const FString& RegionName, uint32 ParentProcessId);
+    virtual ~FIGIGPTWorkerHost();
+
+    virtual uint32 Run() override;
+    virtual void Stop() override { bStopping = true; }
+
+    /** Command line switch that turns a process into an inference worker */
+    static bool IsWorkerProcess(FString* OutRegionName = nullptr, uint32* OutParentProcessId = nullptr);
+
+private:
+    /** Whether to keep serving: false once stopping, or once the game has exited (checked at most once a second), which stops the worker */
+    bool CheckParentProcess();
+
+    // Non-owning ref
+    FIGIGPT& GPT;
+
+    FIGIGPTWorkerChannel Channel;
+    FProcHandle ParentProcess;
+    TUniquePtr<FRunnableThread> Thread;
+    std::atomic<bool> bStopping{ false };
+    double LastParentCheckSeconds{ 0.0 };
+};
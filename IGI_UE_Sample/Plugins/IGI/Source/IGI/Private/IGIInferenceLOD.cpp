@@ -0,0 +1,324 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIInferenceLOD.h"
+
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+
+#include "IGILog.h"
+#include "IGIModule.h"
+
+namespace
+{
+    // Relevance of a speaker next to the player but not in conversation with them, below the conversation tier
+    constexpr float MAX_BYSTANDER_RELEVANCE{ 0.8f };
+
+    // Share of the relevance a speaker keeps off screen
+    constexpr float OFF_SCREEN_RELEVANCE_SCALE{ 0.5f };
+
+    // Tier used when the settings have none: everything is generated
+    const FIGIInferenceLODTier DEFAULT_TIER{};
+
+    int32 GetTopPriority()
+    {
+        int32 TopPriority{ MIN_int32 };
+        for (const FIGIInferenceLODTier& Tier : GetDefault<UIGISettings>()->InferenceLODTiers)
+        {
+            TopPriority = FMath::Max(TopPriority, Tier.Priority);
+        }
+        return TopPriority;
+    }
+
+    uint32 HashRequest(const FIGIGPTRequest& Request)
+    {
+        uint32 Hash = GetTypeHash(Request.SystemPrompt);
+        Hash = HashCombineFast(Hash, GetTypeHash(Request.UserPrompt));
+        Hash = HashCombineFast(Hash, GetTypeHash(Request.AssistantPrompt));
+        return HashCombineFast(Hash, GetTypeHash(Request.Adapter));
+    }
+}
+
+FIGIInferenceLOD::FIGIInferenceLOD()
+    : bAlive(MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(true))
+{
+}
+
+FIGIInferenceLOD::~FIGIInferenceLOD()
+{
+    *bAlive = false;
+}
+
+float FIGIInferenceLOD::ComputeRelevance(const FIGIInferenceRelevance& Relevance)
+{
+    if (Relevance.bInConversation)
+    {
+        return 1.0f;
+    }
+
+    const UIGISettings* Settings = GetDefault<UIGISettings>();
+    const float Range = FMath::Max(Settings->RelevanceFarDistance - Settings->RelevanceNearDistance, 1.0f);
+    const float Proximity = 1.0f - FMath::Clamp((Relevance.Distance - Settings->RelevanceNearDistance) / Range, 0.0f, 1.0f);
+
+    return Proximity * MAX_BYSTANDER_RELEVANCE * (Relevance.bVisible ? 1.0f : OFF_SCREEN_RELEVANCE_SCALE);
+}
+
+const FIGIInferenceLODTier& FIGIInferenceLOD::SelectTier(float Relevance)
+{
+    const FIGIInferenceLODTier* Selected{ nullptr };
+    for (const FIGIInferenceLODTier& Tier : GetDefault<UIGISettings>()->InferenceLODTiers)
+    {
+        if (Tier.MinRelevance <= Relevance && (Selected == nullptr || Tier.MinRelevance > Selected->MinRelevance))
+        {
+            Selected = &Tier;
+        }
+    }
+    return Selected ? *Selected : DEFAULT_TIER;
+}
+
+void FIGIInferenceLOD::Submit(FIGIGPTRequest&& Request, const FIGIInferenceRelevance& Relevance, FString&& CannedResponse, FIGIGPT::FResponseCallback&& OnResponse)
+{
+    const FIGIInferenceLODTier& Tier = SelectTier(ComputeRelevance(Relevance));
+
+    FPendingRequest Pending;
+    Pending.Request = MoveTemp(Request);
+    if (!Tier.bUseAdapter)
+    {
+        Pending.Request.Adapter = NAME_None;
+    }
+    Pending.CannedResponse = MoveTemp(CannedResponse);
+    Pending.OnResponse = MoveTemp(OnResponse);
+    Pending.CacheKey = HashRequest(Pending.Request);
+    Pending.Source = Tier.Source;
+    Pending.MaxTokens = Tier.MaxTokens;
+    Pending.Priority = Tier.Priority;
+    Pending.Sequence = NextSequence++;
+
+    if (Pending.Source == EIGIInferenceSource::Canned || Pending.Source == EIGIInferenceSource::CacheOrCanned)
+    {
+        RespondWithoutGenerating(MoveTemp(Pending), false);
+        return;
+    }
+
+    if (Pending.Source == EIGIInferenceSource::CacheOrGenerate && TryRespondFromCache(Pending, false))
+    {
+        return;
+    }
+
+    Queue.Add(MoveTemp(Pending));
+
+    // Out of room: the least relevant request waiting, the newest among equals, gets its canned text now
+    if (Queue.Num() > GetDefault<UIGISettings>()->MaxQueuedInferenceRequests)
+    {
+        int32 Dropped{ 0 };
+        for (int32 Index = 1; Index < Queue.Num(); ++Index)
+        {
+            if (Queue[Index].Priority < Queue[Dropped].Priority
+                || (Queue[Index].Priority == Queue[Dropped].Priority && Queue[Index].Sequence > Queue[Dropped].Sequence))
+            {
+                Dropped = Index;
+            }
+        }
+
+        FPendingRequest DroppedRequest = MoveTemp(Queue[Dropped]);
+        Queue.RemoveAt(Dropped, EAllowShrinking::No);
+        RespondWithoutGenerating(MoveTemp(DroppedRequest), true);
+    }
+
+    DispatchNext();
+}
+
+bool FIGIInferenceLOD::TryRespondFromCache(FPendingRequest& Pending, bool bAnyLength)
+{
+    FCachedResponse* Cached = Cache.Find(Pending.CacheKey);
+    if (Cached == nullptr || !Cached->Request.Matches(Pending.Request))
+    {
+        return false;
+    }
+
+    const bool bLongEnough = (Cached->MaxTokens == 0) || (Pending.MaxTokens != 0 && Cached->MaxTokens >= Pending.MaxTokens);
+    if (!bLongEnough && !bAnyLength)
+    {
+        return false;
+    }
+
+    Cached->LastUse = ++CacheClock;
+    ++Stats.NumCached;
+    Respond(MoveTemp(Pending.OnResponse), CopyTemp(Cached->Text));
+    return true;
+}
+
+void FIGIInferenceLOD::RespondWithoutGenerating(FPendingRequest&& Pending, bool bDegraded)
+{
+    Stats.NumDegraded += bDegraded ? 1 : 0;
+
+    // A shorter response to the same prompt still beats canned text
+    if (Pending.Source != EIGIInferenceSource::Canned && TryRespondFromCache(Pending, true))
+    {
+        return;
+    }
+
+    ++Stats.NumCanned;
+    Respond(MoveTemp(Pending.OnResponse), MoveTemp(Pending.CannedResponse));
+}
+
+void FIGIInferenceLOD::Respond(FIGIGPT::FResponseCallback&& OnResponse, FString&& Response)
+{
+    // Never from within Submit, so that callers may submit again from their callback
+    AsyncTask(ENamedThreads::GameThread, [bAlive = bAlive, OnResponse = MoveTemp(OnResponse), Response = MoveTemp(Response)]() mutable
+        {
+            if (*bAlive)
+            {
+                OnResponse(MoveTemp(Response));
+            }
+        });
+}
+
+bool FIGIInferenceLOD::HasTokenBudget(int32 Priority)
+{
+    const int32 TokensPerSecond = GetDefault<UIGISettings>()->InferenceTokensPerSecond;
+    if (TokensPerSecond <= 0 || Priority >= GetTopPriority())
+    {
+        return true;
+    }
+
+    // Token bucket holding at most one second of budget
+    const double Now = FPlatformTime::Seconds();
+    TokenBucket = FMath::Min<double>(TokensPerSecond, TokenBucket + (Now - TokenBucketTime) * TokensPerSecond);
+    TokenBucketTime = Now;
+    return TokenBucket > 0.0;
+}
+
+void FIGIInferenceLOD::DispatchNext()
+{
+    while (!bGenerating && Queue.Num() > 0)
+    {
+        int32 Next{ 0 };
+        for (int32 Index = 1; Index < Queue.Num(); ++Index)
+        {
+            if (Queue[Index].Priority > Queue[Next].Priority
+                || (Queue[Index].Priority == Queue[Next].Priority && Queue[Index].Sequence < Queue[Next].Sequence))
+            {
+                Next = Index;
+            }
+        }
+
+        FPendingRequest Pending = MoveTemp(Queue[Next]);
+        Queue.RemoveAt(Next, EAllowShrinking::No);
+
+        if (!HasTokenBudget(Pending.Priority))
+        {
+            RespondWithoutGenerating(MoveTemp(Pending), true);
+            continue;
+        }
+
+        // An identical request may have been generated while this one waited
+        if (Pending.Source == EIGIInferenceSource::CacheOrGenerate && TryRespondFromCache(Pending, false))
+        {
+            continue;
+        }
+
+        bGenerating = true;
+        FIGIModule::Get().GetGPTAsync([this, bAlive = bAlive, Pending = MoveTemp(Pending)](FIGIGPT* GPT) mutable
+            {
+                if (bAlive->load())
+                {
+                    Generate(GPT, MoveTemp(Pending));
+                }
+            });
+    }
+}
+
+void FIGIInferenceLOD::Generate(FIGIGPT* GPT, FPendingRequest&& Pending)
+{
+    if (GPT == nullptr)
+    {
+        OnGenerated(MoveTemp(Pending), FString(), 0);
+        return;
+    }
+
+    // The tier's token limit is applied by cancelling, which works the same whatever hosts the model
+    const int32 MaxTokens = Pending.MaxTokens;
+    TSharedRef<std::atomic<int32>, ESPMode::ThreadSafe> NumTokens = MakeShared<std::atomic<int32>, ESPMode::ThreadSafe>(0);
+    // Copied, as the cache keeps the request next to its response
+    FIGIGPTRequest Request = Pending.Request;
+
+    GPT->EvaluateAsync(MoveTemp(Request),
+        [bAlive = bAlive, NumTokens, MaxTokens](const FString& /*Token*/)
+        {
+            const int32 NumGenerated = ++(*NumTokens);
+            return bAlive->load() && (MaxTokens <= 0 || NumGenerated < MaxTokens);
+        },
+        [this, bAlive = bAlive, NumTokens, Pending = MoveTemp(Pending)](FString&& Response) mutable
+        {
+            if (bAlive->load())
+            {
+                OnGenerated(MoveTemp(Pending), MoveTemp(Response), NumTokens->load());
+            }
+        });
+}
+
+void FIGIInferenceLOD::OnGenerated(FPendingRequest&& Pending, FString&& Response, int32 NumTokens)
+{
+    bGenerating = false;
+    ++Stats.NumGenerated;
+    Stats.NumTokensGenerated += NumTokens;
+
+    if (Pending.Priority < GetTopPriority())
+    {
+        TokenBucket -= NumTokens;
+    }
+
+    const int32 CacheSize = GetDefault<UIGISettings>()->InferenceResponseCacheSize;
+    if (CacheSize > 0 && !Response.IsEmpty())
+    {
+        if (Cache.Num() >= CacheSize && !Cache.Contains(Pending.CacheKey))
+        {
+            uint32 LeastRecentKey{ 0 };
+            uint64 LeastRecentUse{ MAX_uint64 };
+            for (const TPair<uint32, FCachedResponse>& Entry : Cache)
+            {
+                if (Entry.Value.LastUse < LeastRecentUse)
+                {
+                    LeastRecentKey = Entry.Key;
+                    LeastRecentUse = Entry.Value.LastUse;
+                }
+            }
+            Cache.Remove(LeastRecentKey);
+        }
+
+        // A colliding request's response is replaced
+        FCachedResponse& Cached = Cache.FindOrAdd(Pending.CacheKey);
+        Cached.Request = MoveTemp(Pending.Request);
+        Cached.Text = Response;
+        Cached.MaxTokens = Pending.MaxTokens;
+        Cached.LastUse = ++CacheClock;
+    }
+
+    Pending.OnResponse(MoveTemp(Response));
+
+    DispatchNext();
+}
+
+FIGIInferenceLOD::FStats FIGIInferenceLOD::GetStats() const
+{
+    FStats Current = Stats;
+    Current.NumQueued = Queue.Num();
+    return Current;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand LODStatsCommand(
+        TEXT("IGI.LOD.Stats"),
+        TEXT("Prints how the inference LOD served requests so far: generated, cached, canned, degraded for lack of budget, and tokens generated."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                const FIGIInferenceLOD::FStats Stats = FIGIModule::Get().GetInferenceLOD()->GetStats();
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.LOD.Stats: %d generated (%lld tokens), %d cached, %d canned, %d degraded, %d queued"),
+                    Stats.NumGenerated, Stats.NumTokensGenerated, Stats.NumCached, Stats.NumCanned, Stats.NumDegraded, Stats.NumQueued);
+            }));
+}
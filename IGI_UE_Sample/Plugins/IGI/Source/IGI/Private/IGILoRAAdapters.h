@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * LoRA adapters loaded with the GPT instance, under a memory cap. nvigi binds adapters when the instance is created and
+ * can only select among those per request; attaching another one means recreating the instance, i.e. reloading the base
+ * model. So the set is fixed for the life of the instance, and requests for an adapter outside it run on the base model.
+ * Bookkeeping only: FIGIGPT passes the names to nvigi.
+ */
+class FIGILoRAAdapters
+{
+public:
+    void SetCapacity(uint64 InCapacityMB)
+    {
+        CapacityMB = InCapacityMB;
+    }
+
+    void Reset()
+    {
+        Names.Reset();
+        UsedMB = 0;
+    }
+
+    /** Adds Name unless it would exceed the cap; returns whether it is loaded */
+    bool Add(FName Name, uint64 SizeMB)
+    {
+        if (Names.Contains(Name))
+        {
+            return true;
+        }
+        if (UsedMB + SizeMB > CapacityMB)
+        {
+            return false;
+        }
+
+        Names.Add(Name);
+        UsedMB += SizeMB;
+        return true;
+    }
+
+    bool IsLoaded(FName Name) const
+    {
+        return Names.Contains(Name);
+    }
+
+    const TArray<FName>& GetLoaded() const
+    {
+        return Names;
+    }
+
+    uint64 GetUsedMB() const { return UsedMB; }
+
+private:
+    TArray<FName> Names;
+    uint64 CapacityMB{ 0 };
+    uint64 UsedMB{ 0 };
+};
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIModelVariants.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+#include "IGILog.h"
+
+namespace
+{
+    constexpr const TCHAR* const MODEL_CONFIG_FILE{ TEXT("nvigi.model.config.json") };
+
+    // Context and scratch buffers on top of the weights, for configs that do not state the memory they need
+    constexpr int64 MEMORY_OVERHEAD_PERCENT{ 20 };
+}
+
+bool ReadIGIModelVariant(const FString& PluginModelsPath, const FString& GUID, FIGIModelVariant& OutVariant)
+{
+    const FString ModelPath = FPaths::Combine(PluginModelsPath, GUID);
+
+    FString ConfigText;
+    if (!FFileHelper::LoadFileToString(ConfigText, *FPaths::Combine(ModelPath, MODEL_CONFIG_FILE)))
+    {
+        return false;
+    }
+
+    TSharedPtr<FJsonObject> Config;
+    if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ConfigText), Config) || !Config.IsValid())
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: unable to parse %s of model %s"), ANSI_TO_TCHAR(__FUNCTION__), MODEL_CONFIG_FILE, *GUID);
+        return false;
+    }
+
+    TArray<FString> WeightFiles;
+    IFileManager::Get().FindFiles(WeightFiles, *FPaths::Combine(ModelPath, TEXT("*.gguf")), true, false);
+    if (WeightFiles.Num() == 0)
+    {
+        return false;
+    }
+
+    FIGIModelVariant Variant;
+    Variant.GUID = GUID;
+    Config->TryGetStringField(TEXT("name"), Variant.Name);
+
+    // Adapters live next to the base weights and must not count as a part of them
+    const TArray<TSharedPtr<FJsonValue>>* AdapterValues{ nullptr };
+    if (Config->TryGetArrayField(TEXT("loras"), AdapterValues))
+    {
+        for (const TSharedPtr<FJsonValue>& AdapterValue : *AdapterValues)
+        {
+            const TSharedPtr<FJsonObject>* AdapterConfig{ nullptr };
+            FString AdapterName;
+            FIGILoRAAdapter Adapter;
+            if (!AdapterValue->TryGetObject(AdapterConfig) || !(*AdapterConfig)->TryGetStringField(TEXT("name"), AdapterName)
+                || !(*AdapterConfig)->TryGetStringField(TEXT("filename"), Adapter.FileName))
+            {
+                continue;
+            }
+            Adapter.Name = FName(*AdapterName);
+
+            int64 RequiredMemoryMB{ 0 };
+            if (!(*AdapterConfig)->TryGetNumberField(TEXT("vram"), RequiredMemoryMB) || RequiredMemoryMB <= 0)
+            {
+                RequiredMemoryMB = FMath::DivideAndRoundUp<int64>(IFileManager::Get().FileSize(*FPaths::Combine(ModelPath, Adapter.FileName)), 1024 * 1024);
+            }
+            Adapter.RequiredMemoryMB = static_cast<uint64>(FMath::Max<int64>(RequiredMemoryMB, 0));
+
+            WeightFiles.Remove(FPaths::GetCleanFilename(Adapter.FileName));
+            Variant.Adapters.Add(MoveTemp(Adapter));
+        }
+    }
+
+    for (const FString& WeightFile : WeightFiles)
+    {
+        Variant.FileSize += IFileManager::Get().FileSize(*FPaths::Combine(ModelPath, WeightFile));
+    }
+
+    // nemotron-4-mini-4b-instruct_q4_0.gguf -> q4_0
+    if (!Config->TryGetStringField(TEXT("quantization"), Variant.Quantization) && WeightFiles.Num() > 0)
+    {
+        const FString BaseName = FPaths::GetBaseFilename(WeightFiles[0]);
+        const int32 Separator = BaseName.Find(TEXT("_"));
+        Variant.Quantization = (Separator != INDEX_NONE) ? BaseName.RightChop(Separator + 1) : FString();
+    }
+
+    int64 RequiredMemoryMB{ 0 };
+    if (!Config->TryGetNumberField(TEXT("vram"), RequiredMemoryMB) || RequiredMemoryMB <= 0)
+    {
+        RequiredMemoryMB = Variant.FileSize * (100 + MEMORY_OVERHEAD_PERCENT) / 100 / (1024 * 1024);
+    }
+    Variant.RequiredMemoryMB = static_cast<uint64>(RequiredMemoryMB);
+
+    OutVariant = MoveTemp(Variant);
+    return true;
+}
+
+TArray<FIGIModelVariant> FindIGIModelVariants(const FString& PluginModelsPath, const FString& ModelName)
+{
+    TArray<FIGIModelVariant> Variants;
+
+    TArray<FString> ModelDirectories;
+    IFileManager::Get().FindFiles(ModelDirectories, *FPaths::Combine(PluginModelsPath, TEXT("*")), false, true);
+
+    for (const FString& Directory : ModelDirectories)
+    {
+        FIGIModelVariant Variant;
+        if (!ReadIGIModelVariant(PluginModelsPath, Directory, Variant) || !Variant.Name.StartsWith(ModelName, ESearchCase::IgnoreCase))
+        {
+            continue;
+        }
+
+        UE_LOG(LogIGISDK, Log, TEXT("%s: found %s %s (%s), needs %llu MB, %d LoRA adapters"), ANSI_TO_TCHAR(__FUNCTION__), *Variant.Name, *Variant.Quantization,
+            *Variant.GUID, Variant.RequiredMemoryMB, Variant.Adapters.Num());
+
+        Variants.Add(MoveTemp(Variant));
+    }
+
+    return Variants;
+}
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** LoRA adapter declared in a model's config, applied on top of the base weights */
+struct FIGILoRAAdapter
+{
+    FName Name;
+
+    /** Path of the adapter's weights, relative to the model directory */
+    FString FileName;
+
+    /** Video memory the adapter needs once loaded, in MB */
+    uint64 RequiredMemoryMB{ 0 };
+};
+
+/** One quantization of a model, as described by the nvigi.model.config.json next to its weights */
+struct FIGIModelVariant
+{
+    /** Name of the model directory, which is the GUID nvigi loads it by */
+    FString GUID;
+
+    /** Model name from the config, shared by all quantizations of the same model */
+    FString Name;
+
+    /** e.g. q4_0, q8_0, f16; from the config, or from the weights' file name when the config has none */
+    FString Quantization;
+
+    /** Video memory the model needs once loaded, in MB */
+    uint64 RequiredMemoryMB{ 0 };
+
+    /** Size of the weights on disk; more bits per weight means a larger file and a better model */
+    int64 FileSize{ 0 };
+
+    /** LoRA adapters that can be applied on top of this variant */
+    TArray<FIGILoRAAdapter> Adapters;
+};
+
+/** Reads the model in <PluginModelsPath>/<GUID>; returns false when it has no readable config or no weights */
+bool ReadIGIModelVariant(const FString& PluginModelsPath, const FString& GUID, FIGIModelVariant& OutVariant);
+
+/** Finds every variant of ModelName under the models directory of a GPT plugin, e.g. <models>/nvigi.plugin.gpt.ggml */
+TArray<FIGIModelVariant> FindIGIModelVariants(const FString& PluginModelsPath, const FString& ModelName);
+
+/**
+ * Orders the variants to try: those that fit in AvailableMemoryMB from the best to the worst, then, as a last resort
+ * under memory pressure, the smallest of those that do not fit. Has no dependency on nvigi so it can be exercised with
+ * any variant list.
+ */
+inline TArray<int32> RankIGIModelVariants(const TArray<FIGIModelVariant>& Variants, uint64 AvailableMemoryMB)
+{
+    TArray<int32> Ranking;
+    int32 Smallest{ INDEX_NONE };
+
+    for (int32 Index = 0; Index < Variants.Num(); ++Index)
+    {
+        if (Variants[Index].RequiredMemoryMB <= AvailableMemoryMB)
+        {
+            Ranking.Add(Index);
+        }
+        if (Smallest == INDEX_NONE || Variants[Index].RequiredMemoryMB < Variants[Smallest].RequiredMemoryMB)
+        {
+            Smallest = Index;
+        }
+    }
+
+    Ranking.Sort([&Variants](int32 A, int32 B)
+        {
+            return Variants[A].FileSize > Variants[B].FileSize;
+        });
+
+    if (Ranking.Num() == 0 && Smallest != INDEX_NONE)
+    {
+        Ranking.Add(Smallest);
+    }
+
+    return Ranking;
+}
@@ -5,13 +5,30 @@
 #include "IGIModule.h"
 
 #include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
 #include "Misc/MessageDialog.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
 #include "Modules/ModuleManager.h"
 #include "Interfaces/IPluginManager.h"
+#include "Engine/World.h"
 
+#include "IGIBakedDialogue.h"
+#include "IGIBlueprintLibrary.h"
 #include "IGICore.h"
 #include "IGIGPT.h"
+#include "IGIInferenceLOD.h"
+#include "IGIPregeneration.h"
+#include "IGIGPTRemote.h"
+#include "IGIGPTReplay.h"
+#include "IGIGPTServer.h"
+#include "IGIGPTTrace.h"
+#include "IGIGPTWorker.h"
 #include "IGILog.h"
+#include "IGISettings.h"
+#include "IGISyntheticGPT.h"
 
 #include "nvigi.h"
 #include "nvigi_ai.h"
@@ -32,6 +49,22 @@ public:
         FString BaseDir = IPluginManager::Get().FindPlugin("IGI")->GetBaseDir();
         IGICoreLibraryPath = FPaths::Combine(*BaseDir, TEXT("ThirdParty/nvigi_pack/plugins/sdk/bin/x64/nvigi.core.framework.dll"));
         IGIModelsPath = FPaths::Combine(*BaseDir, TEXT("ThirdParty/nvigi_pack/plugins/sdk/data/nvigi.models"));
+
+        FString TracePath;
+        if (FParse::Value(FCommandLine::Get(), TEXT("IGITrace="), TracePath) || FParse::Param(FCommandLine::Get(), TEXT("IGITrace")))
+        {
+            FIGIGPTTraceRecorder::Start(TracePath);
+        }
+
+#if WITH_EDITOR
+        WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([this](UWorld* World, bool bSessionEnded, bool bCleanupResources)
+            {
+                if (World && World->WorldType == EWorldType::PIE && bSessionEnded && !GetDefault<UIGISettings>()->bKeepModelLoadedAcrossPIE)
+                {
+                    ReleaseGPT();
+                }
+            });
+#endif
     }
 
     void ShutdownModule()
@@ -39,25 +72,63 @@ public:
         // This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
         // we call this function before unloading the module.
 
+#if WITH_EDITOR
+        FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+#endif
+
         if (Core)
         {
             UnloadIGICore();
         }
+
+        UIGIGPTEvaluateAsync::EmptyPool();
+        FIGIGPTTraceRecorder::Stop();
     }
 
-    bool LoadIGICore()
+    bool LoadIGICore(FIGIModule* module)
     {
         FScopeLock Lock(&CS);
 
         Core = MakeUnique<FIGICore>(IGICoreLibraryPath);
-        return (Core != nullptr) && (Core->IsInitialized());
+        const bool bLoaded = (Core != nullptr) && (Core->IsInitialized());
+
+        // A server has to be up before its clients send their first request, so its model is loaded right away
+        if (bLoaded && GetDefault<UIGISettings>()->GetHostMode() == EIGIGPTHostMode::Server)
+        {
+            FIGIGPT* ServedGPT = GetGPT(module);
+            Server = MakeUnique<FIGIGPTServer>(*ServedGPT, GetDefault<UIGISettings>()->GetServerPort());
+        }
+
+        // Likewise in a worker process, whose parent is waiting for the model to be ready
+        FString WorkerRegionName;
+        uint32 ParentProcessId{ 0 };
+        if (bLoaded && FIGIGPTWorkerHost::IsWorkerProcess(&WorkerRegionName, &ParentProcessId))
+        {
+            FIGIGPT* HostedGPT = GetGPT(module);
+            WorkerHost = MakeUnique<FIGIGPTWorkerHost>(*HostedGPT, WorkerRegionName, ParentProcessId);
+        }
+
+        return bLoaded;
     }
 
     bool UnloadIGICore()
     {
         FScopeLock Lock(&CS);
 
+        InferenceLOD.Reset();
+        Pregeneration.Reset();
+        Server.Reset();
+        WorkerHost.Reset();
+        LoadedGPT = nullptr;
+        if (GPT.IsValid())
+        {
+            // Background threads may still be inside the model, abandoned pre-generation included
+            GPT->CancelAndWait();
+        }
         GPT.Reset();
+#if PLATFORM_WINDOWS
+        ComputeQueue.SafeRelease();
+#endif
         Core.Reset();
         return true;
     }
@@ -66,6 +137,12 @@ public:
     {
         FScopeLock Lock(&CS);
 
+        if (IGISyntheticGPT::IsFeature(Feature))
+        {
+            *Interface = IGISyntheticGPT::GetInterface();
+            return nvigi::kResultOk;
+        }
+
         return Core->LoadInterface(Feature, nvigi::InferenceInterface::s_type, Interface, UTF8PathToPlugin);
     }
 
@@ -73,18 +150,45 @@ public:
     {
         FScopeLock Lock(&CS);
 
+        if (IGISyntheticGPT::IsFeature(Feature))
+        {
+            return nvigi::kResultOk;
+        }
+
         return Core->UnloadInterface(Feature, Interface);
     }
 
     nvigi::Result CheckPluginCompatibility(const nvigi::PluginID& Feature, const FString& Name) const
     {
+        if (IGISyntheticGPT::IsFeature(Feature))
+        {
+            return nvigi::kResultOk;
+        }
+
         return Core->CheckPluginCompatibility(Feature, Name);
     }
 
-    // Get the D3D12 parameters
+    bool IsInferenceOnRenderAdapter() const
+    {
+        return Core && Core->IsInferenceOnRenderAdapter();
+    }
+
+    uint64 GetInferenceAdapterFreeMemoryMB() const
+    {
+        return Core ? Core->GetInferenceAdapterFreeMemoryMB() : 0;
+    }
+
+    // Get the D3D12 parameters: the engine's device, or one of our own on the inference adapter when the engine does not render on it
     nvigi::D3D12Parameters GetD3D12Parameters() const
     {
         nvigi::D3D12Parameters Parameters;
+
+#if PLATFORM_WINDOWS
+        if (Core && !Core->IsInferenceOnRenderAdapter())
+        {
+            return Core->GetInferenceAdapterD3D12Parameters();
+        }
+#endif
         
         if (!GDynamicRHI && GDynamicRHI->GetInterfaceType() != ERHIInterfaceType::D3D12)
         {
@@ -105,6 +209,36 @@ public:
         constexpr uint32 RHI_DEVICE_INDEX = 0u;
         ID3D12Device* D3D12Device = RHI->RHIGetDevice(RHI_DEVICE_INDEX);
 
+#if PLATFORM_WINDOWS
+        // A queue of our own keeps inference work out of the engine's graphics queue
+        if (GetDefault<UIGISettings>()->bUseDedicatedComputeQueue && D3D12Device)
+        {
+            if (!ComputeQueue.IsValid())
+            {
+                D3D12_COMMAND_QUEUE_DESC QueueDesc{};
+                QueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+                QueueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+                QueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+                QueueDesc.NodeMask = 0u;
+
+                if (FAILED(D3D12Device->CreateCommandQueue(&QueueDesc, IID_PPV_ARGS(ComputeQueue.GetInitReference()))))
+                {
+                    UE_LOG(LogIGISDK, Warning, TEXT("Unable to create a dedicated D3D12 compute queue; using the graphics queue"));
+                    ComputeQueue.SafeRelease();
+                }
+                else
+                {
+                    ComputeQueue->SetName(TEXT("IGI Compute Queue"));
+                }
+            }
+
+            if (ComputeQueue.IsValid())
+            {
+                CmdQ = ComputeQueue.GetReference();
+            }
+        }
+#endif
+
         if (!CmdQ || !D3D12Device)
         {
             UE_LOG(LogIGISDK, Error, TEXT("Unable to retrieve D3D12 device and command queue from UE; cannot use CiG"));
@@ -137,6 +271,12 @@ public:
         }
         UE_LOG(LogIGISDK, Log, TEXT("RHI parameters: %s"), RHI->GetName());
 
+        // The Vulkan RHI only exposes its graphics queue
+        if (GetDefault<UIGISettings>()->bUseDedicatedComputeQueue)
+        {
+            UE_LOG(LogIGISDK, Warning, TEXT("Dedicated compute queue is not available with Vulkan; using the graphics queue"));
+        }
+
         VkQueue VkQ = RHI->RHIGetGraphicsVkQueue();
         VkDevice VkDevice = RHI->RHIGetVkDevice();
 
@@ -159,14 +299,157 @@ public:
         FScopeLock Lock(&CS);
         if(!GPT.IsValid())
         {
-            GPT = MakeUnique<FIGIGPT>(module);
+            const UIGISettings* Settings = GetDefault<UIGISettings>();
+            FString ReplayTracePath;
+            if (FParse::Value(FCommandLine::Get(), TEXT("IGIReplayTrace="), ReplayTracePath))
+            {
+                float ReplaySpeed{ 1.0f };
+                FParse::Value(FCommandLine::Get(), TEXT("IGIReplaySpeed="), ReplaySpeed);
+                GPT = MakeUnique<FIGIGPTReplay>(ReplayTracePath, ReplaySpeed);
+            }
+            else if (Settings->GetHostMode() == EIGIGPTHostMode::Client)
+            {
+                GPT = MakeUnique<FIGIGPTRemote>(Settings->GetServerPort());
+            }
+            else if (Settings->GetHostMode() == EIGIGPTHostMode::Worker)
+            {
+                GPT = MakeUnique<FIGIGPTWorkerClient>();
+            }
+            else
+            {
+                GPT = MakeUnique<FIGIGPT>(module);
+            }
+            LoadedGPT = GPT.Get();
         }
         return GPT.Get();
     }
 
+    // Without the lock, which GetGPT holds for as long as the model loads
+    FIGIGPT* FindGPT() const
+    {
+        check(IsInGameThread());
+        return LoadedGPT.load();
+    }
+
+    void ReleaseGPT()
+    {
+        FScopeLock Lock(&CS);
+
+        // A server or a worker host serves other processes, which may be in the middle of a request
+        if (!GPT.IsValid() || Server.IsValid() || WorkerHost.IsValid())
+        {
+            return;
+        }
+
+        // Pre-generation can wait; it is anticipated again when the GPT next loads
+        if (Pregeneration.IsValid() && !Pregeneration->IsIdle())
+        {
+            Pregeneration->Abandon();
+            UE_LOG(LogIGISDK, Log, TEXT("%s: GPT is generating ahead of time; keeping it loaded"), ANSI_TO_TCHAR(__FUNCTION__));
+            return;
+        }
+
+        if (!GPT->IsIdle())
+        {
+            UE_LOG(LogIGISDK, Log, TEXT("%s: GPT has requests in flight; keeping it loaded"), ANSI_TO_TCHAR(__FUNCTION__));
+            return;
+        }
+
+        LoadedGPT = nullptr;
+        GPT.Reset();
+        UE_LOG(LogIGISDK, Log, TEXT("%s: GPT released"), ANSI_TO_TCHAR(__FUNCTION__));
+    }
+
+    FIGIInferenceLOD* GetInferenceLOD()
+    {
+        check(IsInGameThread());
+        if (!InferenceLOD.IsValid())
+        {
+            InferenceLOD = MakeUnique<FIGIInferenceLOD>();
+        }
+        return InferenceLOD.Get();
+    }
+
+    FIGIPregeneration* GetPregeneration()
+    {
+        check(IsInGameThread());
+        if (!Pregeneration.IsValid())
+        {
+            Pregeneration = MakeUnique<FIGIPregeneration>();
+        }
+        return Pregeneration.Get();
+    }
+
+    bool IsIGICoreLoaded() const
+    {
+        return Core.IsValid() && Core->IsInitialized();
+    }
+
+    bool FindBakedResponse(const FIGIGPTRequest& Request, FString& OutResponse)
+    {
+        {
+            FScopeLock Lock(&BakedDialogueCS);
+            if (!bBakedDialogueOpened)
+            {
+                bBakedDialogueOpened = true;
+                if (GetDefault<UIGISettings>()->bUseBakedDialogue)
+                {
+                    OpenBakedDialogue();
+                }
+            }
+        }
+
+        // Banks are immutable once opened
+        for (const TUniquePtr<FIGIBakedDialogue>& Bank : BakedDialogue)
+        {
+            if (Bank->Find(Request, OutResponse))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
 private:
+    void OpenBakedDialogue()
+    {
+        const FString BankDirectory = FPaths::Combine(FPaths::ProjectContentDir(), TEXT("IGI"));
+
+        TArray<FString> BankFiles;
+        IFileManager::Get().FindFiles(BankFiles, *FPaths::Combine(BankDirectory, FString(TEXT("*")) + FIGIBakedDialogue::EXTENSION), true, false);
+        BankFiles.Sort();
+
+        for (const FString& BankFile : BankFiles)
+        {
+            if (TUniquePtr<FIGIBakedDialogue> Bank = FIGIBakedDialogue::Open(FPaths::Combine(BankDirectory, BankFile)))
+            {
+                BakedDialogue.Add(MoveTemp(Bank));
+            }
+        }
+    }
+
+
     TUniquePtr<FIGICore> Core;
     TUniquePtr<FIGIGPT> GPT;
+    std::atomic<FIGIGPT*> LoadedGPT{ nullptr };
+    TUniquePtr<FIGIGPTServer> Server;
+    TUniquePtr<FIGIGPTWorkerHost> WorkerHost;
+    TUniquePtr<FIGIInferenceLOD> InferenceLOD;
+    TUniquePtr<FIGIPregeneration> Pregeneration;
+
+    // Opened on the first lookup, kept until the module shuts down
+    FCriticalSection BakedDialogueCS;
+    TArray<TUniquePtr<FIGIBakedDialogue>> BakedDialogue;
+    bool bBakedDialogueOpened{ false };
+
+#if WITH_EDITOR
+    FDelegateHandle WorldCleanupHandle;
+#endif
+
+#if PLATFORM_WINDOWS
+    // Created on demand when bUseDedicatedComputeQueue is set
+    mutable TRefCountPtr<ID3D12CommandQueue> ComputeQueue;
+#endif
 
     FCriticalSection CS;
     FString IGICoreLibraryPath;
@@ -191,7 +474,7 @@ void FIGIModule::ShutdownModule()
 
 bool FIGIModule::LoadIGICore()
 {
-    const bool Result{ Pimpl->LoadIGICore() };
+    const bool Result{ Pimpl->LoadIGICore(this) };
     if (Result)
     {
         UE_LOG(LogIGISDK, Log, TEXT("IGI core loaded"));
@@ -250,6 +533,16 @@ nvigi::Result FIGIModule::CheckPluginCompatibility(const nvigi::PluginID& Featur
     return Pimpl->CheckPluginCompatibility(Feature, Name);
 }
 
+bool FIGIModule::IsInferenceOnRenderAdapter() const
+{
+    return Pimpl->IsInferenceOnRenderAdapter();
+}
+
+uint64 FIGIModule::GetInferenceAdapterFreeMemoryMB() const
+{
+    return Pimpl->GetInferenceAdapterFreeMemoryMB();
+}
+
 nvigi::D3D12Parameters FIGIModule::GetD3D12Parameters() const
 {
     return Pimpl->GetD3D12Parameters();
@@ -270,6 +563,59 @@ FIGIGPT* FIGIModule::GetGPT()
     return Pimpl->GetGPT(this);
 }
 
+FIGIGPT* FIGIModule::FindGPT() const
+{
+    return Pimpl->FindGPT();
+}
+
+void FIGIModule::GetGPTAsync(TFunction<void(FIGIGPT*)>&& OnReady)
+{
+    check(IsInGameThread());
+
+    if (FIGIGPT* GPT = FindGPT())
+    {
+        OnReady(GPT);
+        return;
+    }
+
+    // Loading takes seconds, possibly several variants and probes; off the game thread, as requests always did
+    AsyncTask(ENamedThreads::AnyBackgroundHiPriTask, [this, OnReady = MoveTemp(OnReady)]() mutable
+        {
+            GetGPT();
+
+            // Looked up again, as the GPT may have been released in the meantime
+            AsyncTask(ENamedThreads::GameThread, [this, OnReady = MoveTemp(OnReady)]()
+                {
+                    OnReady(FindGPT());
+                });
+        });
+}
+
+void FIGIModule::ReleaseGPT()
+{
+    Pimpl->ReleaseGPT();
+}
+
+FIGIInferenceLOD* FIGIModule::GetInferenceLOD()
+{
+    return Pimpl->GetInferenceLOD();
+}
+
+FIGIPregeneration* FIGIModule::GetPregeneration()
+{
+    return Pimpl->GetPregeneration();
+}
+
+bool FIGIModule::IsIGICoreLoaded() const
+{
+    return Pimpl->IsIGICoreLoaded();
+}
+
+bool FIGIModule::FindBakedResponse(const FIGIGPTRequest& Request, FString& OutResponse)
+{
+    return Pimpl->FindBakedResponse(Request, OutResponse);
+}
+
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FIGIModule, IGI)
@@ -0,0 +1,255 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIPregeneration.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+
+#include "IGILog.h"
+#include "IGIModule.h"
+#include "IGISettings.h"
+
+FIGIPregeneration::FIGIPregeneration()
+    : bAlive(MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(true))
+{
+}
+
+FIGIPregeneration::~FIGIPregeneration()
+{
+    *bAlive = false;
+    if (InFlight)
+    {
+        InFlight->bAbandoned = true;
+    }
+    FTSTicker::GetCoreTicker().RemoveTicker(TickHandle);
+}
+
+void FIGIPregeneration::Anticipate(FIGIGPTRequest&& Request, float ExpirySeconds, int32 Priority)
+{
+    check(IsInGameThread());
+
+    const double Expiry = FPlatformTime::Seconds() + ExpirySeconds;
+
+    if (FStoredResponse* Stored = Responses.FindByPredicate([&Request](const FStoredResponse& Candidate) { return Candidate.Request.Matches(Request); }))
+    {
+        Stored->ExpirySeconds = Expiry;
+        return;
+    }
+
+    FAnticipatedRequest* Anticipated = Queue.FindByPredicate([&Request](const FAnticipatedRequest& Candidate) { return Candidate.Request.Matches(Request); });
+    if (Anticipated == nullptr && InFlight && InFlight->Anticipated.Request.Matches(Request))
+    {
+        Anticipated = &InFlight->Anticipated;
+    }
+    if (Anticipated == nullptr)
+    {
+        Anticipated = &Queue.AddDefaulted_GetRef();
+        Anticipated->Request = MoveTemp(Request);
+        ++Stats.NumAnticipated;
+    }
+
+    Anticipated->ExpirySeconds = Expiry;
+    Anticipated->Priority = Priority;
+    StartTicking();
+}
+
+void FIGIPregeneration::Forget(const FIGIGPTRequest& Request)
+{
+    check(IsInGameThread());
+
+    Queue.RemoveAll([&Request](const FAnticipatedRequest& Candidate) { return Candidate.Request.Matches(Request); });
+    Responses.RemoveAll([&Request](const FStoredResponse& Candidate) { return Candidate.Request.Matches(Request); });
+
+    // Expired, so that it is not anticipated again once abandoned
+    if (InFlight && InFlight->Anticipated.Request.Matches(Request))
+    {
+        InFlight->Anticipated.ExpirySeconds = 0.0;
+        Abandon();
+    }
+}
+
+bool FIGIPregeneration::TakeResponse(const FIGIGPTRequest& Request, FString& OutResponse)
+{
+    check(IsInGameThread());
+
+    if (Responses.IsEmpty())
+    {
+        return false;
+    }
+
+    RemoveExpired(FPlatformTime::Seconds());
+
+    const int32 Index = Responses.IndexOfByPredicate([&Request](const FStoredResponse& Candidate) { return Candidate.Request.Matches(Request); });
+    if (Index == INDEX_NONE)
+    {
+        return false;
+    }
+
+    OutResponse = MoveTemp(Responses[Index].Response);
+    Responses.RemoveAtSwap(Index);
+    ++Stats.NumServed;
+    return true;
+}
+
+void FIGIPregeneration::Abandon()
+{
+    check(IsInGameThread());
+
+    if (InFlight && !InFlight->bAbandoned.exchange(true))
+    {
+        ++Stats.NumAbandoned;
+    }
+}
+
+FIGIPregeneration::FStats FIGIPregeneration::GetStats() const
+{
+    FStats Current = Stats;
+    Current.NumQueued = Queue.Num();
+    Current.NumStored = Responses.Num();
+    return Current;
+}
+
+void FIGIPregeneration::StartTicking()
+{
+    if (!TickHandle.IsValid())
+    {
+        TickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FIGIPregeneration::Tick));
+    }
+}
+
+void FIGIPregeneration::RemoveExpired(double NowSeconds)
+{
+    Stats.NumExpired += Queue.RemoveAll([NowSeconds](const FAnticipatedRequest& Candidate) { return Candidate.ExpirySeconds <= NowSeconds; });
+    Stats.NumExpired += Responses.RemoveAll([NowSeconds](const FStoredResponse& Candidate) { return Candidate.ExpirySeconds <= NowSeconds; });
+}
+
+bool FIGIPregeneration::Tick(float /*DeltaTime*/)
+{
+    RemoveExpired(FPlatformTime::Seconds());
+
+    if (InFlight)
+    {
+        return true;
+    }
+
+    const UIGISettings* Settings = GetDefault<UIGISettings>();
+    if (Queue.IsEmpty() || Settings->PregeneratedResponseCapacity <= 0)
+    {
+        Queue.Reset();
+        TickHandle.Reset();
+        return false;
+    }
+
+    // Lowest priority of all: after frames with time to spare, and while nothing else waits for the model
+    if (Settings->PregenerationMaxFrameMs > 0.0f && FApp::GetDeltaTime() * 1000.0 > Settings->PregenerationMaxFrameMs)
+    {
+        return true;
+    }
+
+    // Never the reason the model is loaded
+    FIGIGPT* GPT = FIGIModule::Get().FindGPT();
+    if (GPT == nullptr || !GPT->IsIdle())
+    {
+        return true;
+    }
+
+    // Highest priority first, then the one expiring soonest
+    int32 Next{ 0 };
+    for (int32 Index = 1; Index < Queue.Num(); ++Index)
+    {
+        if (Queue[Index].Priority > Queue[Next].Priority
+            || (Queue[Index].Priority == Queue[Next].Priority && Queue[Index].ExpirySeconds < Queue[Next].ExpirySeconds))
+        {
+            Next = Index;
+        }
+    }
+
+    InFlight = MakeShared<FInFlight, ESPMode::ThreadSafe>();
+    InFlight->Anticipated = MoveTemp(Queue[Next]);
+    Queue.RemoveAtSwap(Next);
+
+    // Not through EvaluateAsync, which would take it for a request that pre-generation must yield to
+    const TSharedRef<FInFlight, ESPMode::ThreadSafe> Generated = InFlight.ToSharedRef();
+    GPT->EvaluateSpeculatively(CopyTemp(Generated->Anticipated.Request),
+        [Generated](const FString& /*Token*/)
+        {
+            return !Generated->bAbandoned.load();
+        },
+        [this, Generated, bAlive = bAlive](FString&& Response)
+        {
+            if (*bAlive)
+            {
+                OnGenerated(Generated, MoveTemp(Response));
+            }
+        });
+
+    return true;
+}
+
+void FIGIPregeneration::OnGenerated(const TSharedRef<FInFlight, ESPMode::ThreadSafe>& Generated, FString&& Response)
+{
+    InFlight.Reset();
+
+    FAnticipatedRequest& Anticipated = Generated->Anticipated;
+    if (Anticipated.ExpirySeconds <= FPlatformTime::Seconds())
+    {
+        ++Stats.NumExpired;
+        return;
+    }
+
+    // Starts over once the model is idle again
+    if (Generated->bAbandoned)
+    {
+        Queue.Add(MoveTemp(Anticipated));
+        StartTicking();
+        return;
+    }
+
+    if (!Response.IsEmpty())
+    {
+        ++Stats.NumGenerated;
+        Store(MoveTemp(Anticipated), MoveTemp(Response));
+    }
+}
+
+void FIGIPregeneration::Store(FAnticipatedRequest&& Anticipated, FString&& Response)
+{
+    // Full: the response expiring soonest makes room
+    const int32 Capacity = GetDefault<UIGISettings>()->PregeneratedResponseCapacity;
+    while (Responses.Num() >= Capacity && !Responses.IsEmpty())
+    {
+        int32 Evicted{ 0 };
+        for (int32 Index = 1; Index < Responses.Num(); ++Index)
+        {
+            if (Responses[Index].ExpirySeconds < Responses[Evicted].ExpirySeconds)
+            {
+                Evicted = Index;
+            }
+        }
+        Responses.RemoveAtSwap(Evicted);
+        ++Stats.NumEvicted;
+    }
+
+    FStoredResponse& Stored = Responses.AddDefaulted_GetRef();
+    Stored.Request = MoveTemp(Anticipated.Request);
+    Stored.Response = MoveTemp(Response);
+    Stored.ExpirySeconds = Anticipated.ExpirySeconds;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand PregenerationStatsCommand(
+        TEXT("IGI.Pregen.Stats"),
+        TEXT("Prints how many anticipated requests were generated in idle time, served, abandoned for other requests, expired and evicted."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                const FIGIPregeneration::FStats Stats = FIGIModule::Get().GetPregeneration()->GetStats();
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.Pregen.Stats: %d anticipated, %d generated, %d served, %d abandoned, %d expired, %d evicted; %d queued, %d stored"),
+                    Stats.NumAnticipated, Stats.NumGenerated, Stats.NumServed, Stats.NumAbandoned, Stats.NumExpired, Stats.NumEvicted,
+                    Stats.NumQueued, Stats.NumStored);
+            }));
+}
@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIPromptBuilder.h"
+
+#include "IGILog.h"
+#include "IGIModule.h"
+
+namespace
+{
+    // Tokens reserved for the chat template the GPT plugin wraps around the system, user and assistant slots
+    constexpr int32 PROMPT_TEMPLATE_TOKENS{ 64 };
+
+    // Default share of the available context given to each section, in percent
+    constexpr int32 DEFAULT_BUDGET_PERCENT[static_cast<int32>(EIGIPromptSection::Num)]{ 20, 15, 35, 10, 20 };
+
+    // Evicted turns beyond this count are dropped without being summarized
+    constexpr int32 MAX_TURNS_TO_SUMMARIZE{ 64 };
+
+    constexpr const TCHAR* const SUMMARY_SYSTEM_PROMPT{ TEXT("Summarize the conversation below in a few sentences. Keep names, facts, promises and open questions. Reply with the summary only.") };
+    constexpr const TCHAR* const SUMMARY_PREFIX{ TEXT("Earlier in the conversation: ") };
+
+    FString FormatTurn(const FIGIPromptTurn& Turn)
+    {
+        return FString::Printf(TEXT("%s: %s"), *Turn.Speaker, *Turn.Text);
+    }
+}
+
+struct FIGIPromptBuilder::FState
+{
+    int32 Budgets[static_cast<int32>(EIGIPromptSection::Num)]{};
+
+    FString SystemPrompt;
+    FString Memory;
+    FString Context;
+    FString Summary;
+    FName Adapter;
+
+    TArray<FIGIPromptTurn> History;
+    TArray<int32> HistoryTokens;
+
+    TArray<FIGIPromptTurn> TurnsToSummarize;
+    bool bSummarizing{ false };
+
+    int32 LastPromptTokens{ 0 };
+};
+
+FIGIPromptBuilder::FIGIPromptBuilder()
+    : State(MakeShared<FState>())
+{
+    const int32 AvailableTokens = GetAvailableTokens();
+    for (int32 Section = 0; Section < static_cast<int32>(EIGIPromptSection::Num); ++Section)
+    {
+        State->Budgets[Section] = AvailableTokens * DEFAULT_BUDGET_PERCENT[Section] / 100;
+    }
+}
+
+int32 FIGIPromptBuilder::GetAvailableTokens() const
+{
+    return FMath::Max(0, FIGIGPT::GetContextSize() - FIGIGPT::GetMaxTokensToPredict() - PROMPT_TEMPLATE_TOKENS);
+}
+
+void FIGIPromptBuilder::SetBudget(EIGIPromptSection Section, int32 NumTokens)
+{
+    int32 OtherBudgets{ 0 };
+    for (int32 Other = 0; Other < static_cast<int32>(EIGIPromptSection::Num); ++Other)
+    {
+        OtherBudgets += (Other != static_cast<int32>(Section)) ? State->Budgets[Other] : 0;
+    }
+
+    const int32 MaxBudget = FMath::Max(0, GetAvailableTokens() - OtherBudgets);
+    if (NumTokens > MaxBudget)
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: budget of %d tokens does not fit in the context; clamped to %d"), ANSI_TO_TCHAR(__FUNCTION__), NumTokens, MaxBudget);
+    }
+
+    State->Budgets[static_cast<int32>(Section)] = FMath::Clamp(NumTokens, 0, MaxBudget);
+}
+
+int32 FIGIPromptBuilder::GetBudget(EIGIPromptSection Section) const
+{
+    return State->Budgets[static_cast<int32>(Section)];
+}
+
+void FIGIPromptBuilder::SetSystemPrompt(FString&& SystemPrompt)
+{
+    State->SystemPrompt = MoveTemp(SystemPrompt);
+}
+
+void FIGIPromptBuilder::SetMemory(FString&& Memory)
+{
+    State->Memory = MoveTemp(Memory);
+}
+
+void FIGIPromptBuilder::SetContext(FString&& Context)
+{
+    State->Context = MoveTemp(Context);
+}
+
+void FIGIPromptBuilder::SetAdapter(FName Adapter)
+{
+    State->Adapter = Adapter;
+}
+
+void FIGIPromptBuilder::AddTurn(FString&& Speaker, FString&& Text)
+{
+    FIGIPromptTurn Turn{ MoveTemp(Speaker), MoveTemp(Text) };
+    State->HistoryTokens.Add(FIGIGPT::CountTokens(FormatTurn(Turn)) + 1);
+    State->History.Add(MoveTemp(Turn));
+}
+
+void FIGIPromptBuilder::ResetHistory()
+{
+    State->History.Reset();
+    State->HistoryTokens.Reset();
+    State->TurnsToSummarize.Reset();
+    State->Summary.Reset();
+}
+
+const TArray<FIGIPromptTurn>& FIGIPromptBuilder::GetHistory() const
+{
+    return State->History;
+}
+
+const FString& FIGIPromptBuilder::GetSummary() const
+{
+    return State->Summary;
+}
+
+int32 FIGIPromptBuilder::GetLastPromptTokens() const
+{
+    return State->LastPromptTokens;
+}
+
+bool FIGIPromptBuilder::HasTurnsToSummarize() const
+{
+    return State->TurnsToSummarize.Num() > 0;
+}
+
+FString FIGIPromptBuilder::TruncateToBudget(const FString& Text, int32 NumTokens, bool bKeepEnd) const
+{
+    if (FIGIGPT::CountTokens(Text) <= NumTokens)
+    {
+        return Text;
+    }
+
+    // Largest number of characters that still fits, found by bisection
+    int32 Low{ 0 };
+    int32 High{ Text.Len() };
+    while (Low < High)
+    {
+        const int32 Mid = (Low + High + 1) / 2;
+        const FStringView Candidate = bKeepEnd ? FStringView(Text).Right(Mid) : FStringView(Text).Left(Mid);
+        if (FIGIGPT::CountTokens(Candidate) <= NumTokens)
+        {
+            Low = Mid;
+        }
+        else
+        {
+            High = Mid - 1;
+        }
+    }
+
+    return bKeepEnd ? Text.Right(Low) : Text.Left(Low);
+}
+
+FIGIGPTRequest FIGIPromptBuilder::Build(FString&& UserPrompt)
+{
+    FState& S = State.Get();
+
+    const int32 HistoryBudget = S.Budgets[static_cast<int32>(EIGIPromptSection::History)];
+
+    // The summary may use at most half of the history budget; recent turns get the rest
+    FString SummaryText;
+    if (!S.Summary.IsEmpty())
+    {
+        SummaryText = TruncateToBudget(SUMMARY_PREFIX + S.Summary, HistoryBudget / 2, false);
+    }
+
+    int32 HistoryTokens = FIGIGPT::CountTokens(SummaryText);
+    for (const int32 TurnTokens : S.HistoryTokens)
+    {
+        HistoryTokens += TurnTokens;
+    }
+
+    // Evict the oldest turns until the history fits, always keeping the most recent one
+    int32 NumEvicted{ 0 };
+    while (HistoryTokens > HistoryBudget && S.History.Num() - NumEvicted > 1)
+    {
+        HistoryTokens -= S.HistoryTokens[NumEvicted];
+        ++NumEvicted;
+    }
+
+    if (NumEvicted > 0)
+    {
+        for (int32 Turn = 0; Turn < NumEvicted; ++Turn)
+        {
+            S.TurnsToSummarize.Add(MoveTemp(S.History[Turn]));
+        }
+        S.History.RemoveAt(0, NumEvicted);
+        S.HistoryTokens.RemoveAt(0, NumEvicted);
+
+        if (S.TurnsToSummarize.Num() > MAX_TURNS_TO_SUMMARIZE)
+        {
+            S.TurnsToSummarize.RemoveAt(0, S.TurnsToSummarize.Num() - MAX_TURNS_TO_SUMMARIZE);
+        }
+    }
+
+    TStringBuilder<4096> SystemSection;
+    SystemSection << TruncateToBudget(S.SystemPrompt, S.Budgets[static_cast<int32>(EIGIPromptSection::System)], false);
+
+    if (!S.Memory.IsEmpty())
+    {
+        SystemSection << TEXT("\n\n") << TruncateToBudget(S.Memory, S.Budgets[static_cast<int32>(EIGIPromptSection::Memory)], false);
+    }
+
+    if (!SummaryText.IsEmpty() || S.History.Num() > 0)
+    {
+        SystemSection << TEXT("\n");
+        if (!SummaryText.IsEmpty())
+        {
+            SystemSection << TEXT("\n") << SummaryText;
+        }
+
+        for (int32 Turn = 0; Turn < S.History.Num(); ++Turn)
+        {
+            FString Line = FormatTurn(S.History[Turn]);
+
+            // A single turn larger than the whole budget keeps its end
+            if (HistoryTokens > HistoryBudget && Turn == S.History.Num() - 1)
+            {
+                Line = TruncateToBudget(Line, HistoryBudget - (HistoryTokens - S.HistoryTokens[Turn]), true);
+            }
+
+            SystemSection << TEXT("\n") << Line;
+        }
+    }
+
+    if (!S.Context.IsEmpty())
+    {
+        SystemSection << TEXT("\n\n") << TruncateToBudget(S.Context, S.Budgets[static_cast<int32>(EIGIPromptSection::Context)], false);
+    }
+
+    FIGIGPTRequest Request;
+    Request.SystemPrompt = SystemSection.ToString();
+    Request.UserPrompt = TruncateToBudget(UserPrompt, S.Budgets[static_cast<int32>(EIGIPromptSection::User)], true);
+    Request.Adapter = S.Adapter;
+
+    S.LastPromptTokens = FIGIGPT::CountTokens(Request.SystemPrompt) + FIGIGPT::CountTokens(Request.UserPrompt) + PROMPT_TEMPLATE_TOKENS;
+
+    return Request;
+}
+
+FIGISavedConversation FIGIPromptBuilder::SaveSession() const
+{
+    const FState& S = State.Get();
+
+    FIGISavedConversation Saved;
+    Saved.SystemPrompt = S.SystemPrompt;
+    Saved.Memory = S.Memory;
+    Saved.Context = S.Context;
+    Saved.Summary = S.Summary;
+    Saved.Adapter = S.Adapter;
+    for (const FIGIPromptTurn& Turn : S.History)
+    {
+        FIGISavedTurn& SavedTurn = Saved.History.AddDefaulted_GetRef();
+        SavedTurn.Speaker = Turn.Speaker;
+        SavedTurn.Text = Turn.Text;
+    }
+    for (const FIGIPromptTurn& Turn : S.TurnsToSummarize)
+    {
+        FIGISavedTurn& SavedTurn = Saved.TurnsToSummarize.AddDefaulted_GetRef();
+        SavedTurn.Speaker = Turn.Speaker;
+        SavedTurn.Text = Turn.Text;
+    }
+
+    return Saved;
+}
+
+void FIGIPromptBuilder::RestoreSession(const FIGISavedConversation& Saved)
+{
+    ResetHistory();
+
+    FState& S = State.Get();
+    S.SystemPrompt = Saved.SystemPrompt;
+    S.Memory = Saved.Memory;
+    S.Context = Saved.Context;
+    S.Summary = Saved.Summary;
+    S.Adapter = Saved.Adapter;
+    for (const FIGISavedTurn& Turn : Saved.History)
+    {
+        AddTurn(CopyTemp(Turn.Speaker), CopyTemp(Turn.Text));
+    }
+    for (const FIGISavedTurn& Turn : Saved.TurnsToSummarize)
+    {
+        S.TurnsToSummarize.Add({ Turn.Speaker, Turn.Text });
+    }
+}
+
+void FIGIPromptBuilder::SummarizeHistoryAsync()
+{
+    FState& S = State.Get();
+    if (S.bSummarizing || S.TurnsToSummarize.Num() == 0)
+    {
+        return;
+    }
+
+    // Upkeep never loads the model; the turns wait for the next call once it is loaded
+    FIGIGPT* GPT = FIGIModule::Get().FindGPT();
+    if (GPT == nullptr)
+    {
+        return;
+    }
+
+    TStringBuilder<4096> Conversation;
+    if (!S.Summary.IsEmpty())
+    {
+        Conversation << SUMMARY_PREFIX << S.Summary << TEXT("\n");
+    }
+    for (const FIGIPromptTurn& Turn : S.TurnsToSummarize)
+    {
+        Conversation << FormatTurn(Turn) << TEXT("\n");
+    }
+    S.TurnsToSummarize.Reset();
+    S.bSummarizing = true;
+
+    // The summary request obeys the same context limits as any other request
+    const int32 SummaryBudget = GetAvailableTokens() - FIGIGPT::CountTokens(SUMMARY_SYSTEM_PROMPT);
+
+    FIGIGPTRequest Request;
+    Request.SystemPrompt = SUMMARY_SYSTEM_PROMPT;
+    Request.UserPrompt = TruncateToBudget(Conversation.ToString(), SummaryBudget, true);
+
+    // Upkeep: waits for the player's requests and the work done ahead of them rather than preempting it
+    GPT->EvaluateWhenIdle(MoveTemp(Request), [WeakState = TWeakPtr<FState>(State)](FString&& Response)
+        {
+            if (TSharedPtr<FState> PinnedState = WeakState.Pin())
+            {
+                Response.TrimStartAndEndInline();
+                if (!Response.IsEmpty())
+                {
+                    PinnedState->Summary = MoveTemp(Response);
+                }
+                PinnedState->bSummarizing = false;
+            }
+        });
+}
@@ -0,0 +1,240 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGIReplicatedResponseComponent.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+
+#include "IGIGPT.h"
+#include "IGILog.h"
+#include "IGIModule.h"
+
+namespace
+{
+    // Response id and offset of a delta
+    constexpr uint64 DELTA_HEADER_BYTES{ 2 * sizeof(int32) };
+
+    UIGIReplicatedResponseComponent::FStats NetStats;
+
+    // What FString net serialization takes: its length, then one byte per character when all are ANSI and two otherwise
+    uint64 GetNetBytes(const FString& Text)
+    {
+        const bool bAnsi = FCString::IsPureAnsi(*Text);
+        return sizeof(int32) + static_cast<uint64>(Text.Len() + 1) * (bAnsi ? 1 : 2);
+    }
+}
+
+UIGIReplicatedResponseComponent::UIGIReplicatedResponseComponent()
+{
+    PrimaryComponentTick.bCanEverTick = true;
+    PrimaryComponentTick.bStartWithTickEnabled = false;
+    SetIsReplicatedByDefault(true);
+}
+
+void UIGIReplicatedResponseComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+    Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+    // Once per channel; the deltas keep it up to date from there
+    DOREPLIFETIME_CONDITION(UIGIReplicatedResponseComponent, Snapshot, COND_InitialOnly);
+}
+
+void UIGIReplicatedResponseComponent::GenerateResponse(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt)
+{
+    if (GetOwnerRole() != ROLE_Authority)
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: only the server generates responses"), ANSI_TO_TCHAR(__FUNCTION__));
+        return;
+    }
+
+    CancelStream();
+
+    // Clears the previous response everywhere before the first delta of this one
+    MulticastAppendResponse(NextResponseId++, 0, FString(), false);
+    SentLength = 0;
+    SecondsSinceFlush = 0.0f;
+    ++NetStats.NumResponses;
+
+    TSharedPtr<FStream, ESPMode::ThreadSafe> NewStream = MakeShared<FStream, ESPMode::ThreadSafe>();
+    Stream = NewStream;
+
+    FIGIModule::Get().GetGPTAsync([NewStream, Request = FIGIGPTRequest{ SystemPrompt, UserPrompt, AssistantPrompt }](FIGIGPT* GPT) mutable
+        {
+            {
+                FScopeLock Lock(&NewStream->CS);
+                if (NewStream->bCancelled || GPT == nullptr)
+                {
+                    NewStream->bComplete = true;
+                    return;
+                }
+            }
+
+            GPT->EvaluateAsync(MoveTemp(Request),
+                [NewStream](const FString& Token)
+                {
+                    FScopeLock Lock(&NewStream->CS);
+                    NewStream->PendingText += Token;
+                    return !NewStream->bCancelled;
+                },
+                [NewStream](FString&& /*Response*/)
+                {
+                    FScopeLock Lock(&NewStream->CS);
+                    NewStream->bComplete = true;
+                });
+        });
+
+    SetComponentTickEnabled(true);
+}
+
+void UIGIReplicatedResponseComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    if (!Stream)
+    {
+        SetComponentTickEnabled(false);
+        return;
+    }
+
+    bool bComplete{ false };
+    {
+        FScopeLock Lock(&Stream->CS);
+        bComplete = Stream->bComplete;
+    }
+
+    SecondsSinceFlush += DeltaTime;
+    if (bComplete || SecondsSinceFlush >= FlushInterval)
+    {
+        Flush();
+    }
+}
+
+void UIGIReplicatedResponseComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    CancelStream();
+    Super::EndPlay(EndPlayReason);
+}
+
+void UIGIReplicatedResponseComponent::Flush()
+{
+    FString Delta;
+    bool bComplete{ false };
+    {
+        FScopeLock Lock(&Stream->CS);
+        Delta = MoveTemp(Stream->PendingText);
+        Stream->PendingText.Reset();
+        bComplete = Stream->bComplete;
+    }
+
+    SecondsSinceFlush = 0.0f;
+    if (Delta.IsEmpty() && !bComplete)
+    {
+        return;
+    }
+
+    const int32 Offset = SentLength;
+    SentLength += Delta.Len();
+
+    ++NetStats.NumDeltas;
+    NetStats.DeltaBytes += DELTA_HEADER_BYTES + GetNetBytes(Delta);
+    NetStats.FullResponseBytes += GetNetBytes(Snapshot.Text + Delta);
+
+    MulticastAppendResponse(Snapshot.ResponseId, Offset, Delta, bComplete);
+
+    if (bComplete)
+    {
+        Stream.Reset();
+        SetComponentTickEnabled(false);
+    }
+}
+
+void UIGIReplicatedResponseComponent::CancelStream()
+{
+    if (!Stream)
+    {
+        return;
+    }
+
+    {
+        FScopeLock Lock(&Stream->CS);
+        Stream->bCancelled = true;
+    }
+    Stream.Reset();
+    SetComponentTickEnabled(false);
+}
+
+void UIGIReplicatedResponseComponent::MulticastAppendResponse_Implementation(int32 ResponseId, int32 Offset, const FString& Delta, bool bComplete)
+{
+    if (ResponseId != Snapshot.ResponseId)
+    {
+        // A delta of an older response than the snapshot's; a newer one always starts with an empty delta at offset 0
+        if (ResponseId < Snapshot.ResponseId || Offset != 0)
+        {
+            return;
+        }
+
+        Snapshot.ResponseId = ResponseId;
+        Snapshot.Text.Reset();
+        Snapshot.bComplete = false;
+    }
+
+    if (Snapshot.bComplete)
+    {
+        return;
+    }
+
+    // The snapshot of a channel opened in the meantime may already hold the start of the delta
+    const int32 Overlap = Snapshot.Text.Len() - Offset;
+    if (Overlap < 0)
+    {
+        UE_LOG(LogIGISDK, Warning, TEXT("%s: %d characters of response %d missing"), ANSI_TO_TCHAR(__FUNCTION__), -Overlap, ResponseId);
+        return;
+    }
+
+    if (Overlap < Delta.Len())
+    {
+        Snapshot.Text.AppendChars(*Delta + Overlap, Delta.Len() - Overlap);
+        OnResponseUpdated.Broadcast(Snapshot.Text);
+    }
+
+    if (bComplete)
+    {
+        Snapshot.bComplete = true;
+        OnResponseCompleted.Broadcast(Snapshot.Text);
+    }
+}
+
+void UIGIReplicatedResponseComponent::OnRep_Snapshot()
+{
+    if (!Snapshot.Text.IsEmpty())
+    {
+        OnResponseUpdated.Broadcast(Snapshot.Text);
+    }
+
+    if (Snapshot.bComplete)
+    {
+        OnResponseCompleted.Broadcast(Snapshot.Text);
+    }
+}
+
+const UIGIReplicatedResponseComponent::FStats& UIGIReplicatedResponseComponent::GetStats()
+{
+    return NetStats;
+}
+
+// ----------------------------------
+
+namespace
+{
+    FAutoConsoleCommand NetStatsCommand(
+        TEXT("IGI.Net.Stats"),
+        TEXT("Prints the bytes the server sent for replicated responses, against replicating the whole response at every flush."),
+        FConsoleCommandDelegate::CreateLambda([]()
+            {
+                const UIGIReplicatedResponseComponent::FStats& Stats = UIGIReplicatedResponseComponent::GetStats();
+                UE_LOG(LogIGISDK, Log, TEXT("IGI.Net.Stats: %llu responses, %llu deltas, %llu bytes per relevant client; %llu bytes replicating whole responses"),
+                    Stats.NumResponses, Stats.NumDeltas, Stats.DeltaBytes, Stats.FullResponseBytes);
+            }));
+}
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGISettings.h"
+
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+UIGISettings::UIGISettings()
+{
+    CategoryName = TEXT("Plugins");
+    SectionName = TEXT("IGI");
+
+    auto AddLODTier = [this](float MinRelevance, EIGIInferenceSource Source, int32 MaxTokens, int32 Priority, bool bUseAdapter)
+        {
+            FIGIInferenceLODTier& Tier = InferenceLODTiers.AddDefaulted_GetRef();
+            Tier.MinRelevance = MinRelevance;
+            Tier.Source = Source;
+            Tier.MaxTokens = MaxTokens;
+            Tier.Priority = Priority;
+            Tier.bUseAdapter = bUseAdapter;
+        };
+
+    // Conversation partner, nearby and visible, within earshot, background
+    AddLODTier(0.9f, EIGIInferenceSource::Generate, 0, 100, true);
+    AddLODTier(0.5f, EIGIInferenceSource::CacheOrGenerate, 64, 50, true);
+    AddLODTier(0.2f, EIGIInferenceSource::CacheOrGenerate, 24, 0, false);
+    AddLODTier(0.0f, EIGIInferenceSource::CacheOrCanned, 0, 0, false);
+}
+
+EIGIGPTHostMode UIGISettings::GetHostMode() const
+{
+    FString Value;
+
+    // The worker process itself hosts the model
+    if (FParse::Value(FCommandLine::Get(), TEXT("IGIWorker="), Value))
+    {
+        return EIGIGPTHostMode::InProcess;
+    }
+
+    if (FParse::Value(FCommandLine::Get(), TEXT("IGIHostMode="), Value))
+    {
+        const int64 Mode = StaticEnum<EIGIGPTHostMode>()->GetValueByNameString(Value);
+        if (Mode != INDEX_NONE)
+        {
+            return static_cast<EIGIGPTHostMode>(Mode);
+        }
+    }
+    return HostMode;
+}
+
+EIGIGPTBackend UIGISettings::GetGPTBackend() const
+{
+    FString Value;
+    if (FParse::Value(FCommandLine::Get(), TEXT("IGIGPTBackend="), Value))
+    {
+        const int64 Backend = StaticEnum<EIGIGPTBackend>()->GetValueByNameString(Value);
+        if (Backend != INDEX_NONE)
+        {
+            return static_cast<EIGIGPTBackend>(Backend);
+        }
+    }
+    return GPTBackend;
+}
+
+int32 UIGISettings::GetServerPort() const
+{
+    int32 Port{ ServerPort };
+    FParse::Value(FCommandLine::Get(), TEXT("IGIServerPort="), Port);
+    return Port;
+}
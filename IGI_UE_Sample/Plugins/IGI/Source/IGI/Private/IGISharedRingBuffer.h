@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+/**
+ * Lock-free single producer, single consumer ring of variable-size records, laid out in caller-provided memory so
+ * that it can live in a region shared between processes. Records are always contiguous: a record that would straddle
+ * the end of the ring is preceded by a padding record and written at the start instead. This lets writers encode
+ * straight into the ring and readers decode straight out of it.
+ */
+class FIGISharedRingBuffer
+{
+public:
+    static constexpr uint64 GetRequiredSize(uint64 Capacity)
+    {
+        return sizeof(FIndices) + Capacity;
+    }
+
+    /** Lays out an empty ring in Memory. Capacity must be a multiple of RECORD_ALIGNMENT. */
+    void Initialize(void* Memory, uint64 InCapacity)
+    {
+        check(InCapacity % RECORD_ALIGNMENT == 0);
+        Indices = new (Memory) FIndices();
+        Data = static_cast<uint8*>(Memory) + sizeof(FIndices);
+        Capacity = InCapacity;
+    }
+
+    /** Uses a ring laid out by Initialize, possibly in another process */
+    void Attach(void* Memory, uint64 InCapacity)
+    {
+        Indices = static_cast<FIndices*>(Memory);
+        Data = static_cast<uint8*>(Memory) + sizeof(FIndices);
+        Capacity = InCapacity;
+    }
+
+    /** Largest payload that can ever be written */
+    uint64 GetMaxPayloadSize() const
+    {
+        return Capacity / 2 - sizeof(FRecordHeader);
+    }
+
+    /** Producer: reserves PayloadSize contiguous bytes, or returns nullptr when the ring is too full */
+    uint8* BeginWrite(uint32 PayloadSize)
+    {
+        const uint64 RecordSize = Align(sizeof(FRecordHeader) + PayloadSize, RECORD_ALIGNMENT);
+        const uint64 Head = Indices->Head.load(std::memory_order_relaxed);
+        const uint64 Tail = Indices->Tail.load(std::memory_order_acquire);
+        const uint64 Offset = Head % Capacity;
+        const uint64 Padding = (Offset + RecordSize > Capacity) ? Capacity - Offset : 0;
+
+        if (PayloadSize > GetMaxPayloadSize() || (Head - Tail) + Padding + RecordSize > Capacity)
+        {
+            return nullptr;
+        }
+
+        if (Padding > 0)
+        {
+            *reinterpret_cast<FRecordHeader*>(Data + Offset) = { 0u, PADDING_RECORD };
+        }
+
+        uint8* Record = Data + (Head + Padding) % Capacity;
+        *reinterpret_cast<FRecordHeader*>(Record) = { PayloadSize, 0u };
+
+        PendingWriteSize = Padding + RecordSize;
+        return Record + sizeof(FRecordHeader);
+    }
+
+    /** Producer: publishes the record reserved by BeginWrite */
+    void EndWrite()
+    {
+        Indices->Head.store(Indices->Head.load(std::memory_order_relaxed) + PendingWriteSize, std::memory_order_release);
+        PendingWriteSize = 0;
+    }
+
+    /** Consumer: returns the oldest record, if any, without copying it */
+    bool BeginRead(TConstArrayView<uint8>& OutPayload)
+    {
+        uint64 Tail = Indices->Tail.load(std::memory_order_relaxed);
+        const uint64 Head = Indices->Head.load(std::memory_order_acquire);
+
+        while (Tail != Head)
+        {
+            const uint64 Offset = Tail % Capacity;
+            const FRecordHeader& Header = *reinterpret_cast<const FRecordHeader*>(Data + Offset);
+            if (Header.Flags & PADDING_RECORD)
+            {
+                Tail += Capacity - Offset;
+                Indices->Tail.store(Tail, std::memory_order_release);
+                continue;
+            }
+
+            OutPayload = TConstArrayView<uint8>(Data + Offset + sizeof(FRecordHeader), Header.Size);
+            PendingReadSize = Align(sizeof(FRecordHeader) + Header.Size, RECORD_ALIGNMENT);
+            return true;
+        }
+
+        return false;
+    }
+
+    /** Consumer: releases the record returned by BeginRead */
+    void EndRead()
+    {
+        Indices->Tail.store(Indices->Tail.load(std::memory_order_relaxed) + PendingReadSize, std::memory_order_release);
+        PendingReadSize = 0;
+    }
+
+    static constexpr uint64 RECORD_ALIGNMENT{ 8 };
+
+private:
+    static constexpr uint32 PADDING_RECORD{ 1u };
+
+    struct FRecordHeader
+    {
+        uint32 Size;
+        uint32 Flags;
+    };
+
+    // Producer and consumer indices on separate cache lines; both only ever grow
+    struct FIndices
+    {
+        alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> Head{ 0 };
+        alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> Tail{ 0 };
+    };
+    static_assert(std::atomic<uint64>::is_always_lock_free, "Shared ring indices must be lock-free to work across processes");
+
+    FIndices* Indices{ nullptr };
+    uint8* Data{ nullptr };
+    uint64 Capacity{ 0 };
+
+    uint64 PendingWriteSize{ 0 };
+    uint64 PendingReadSize{ 0 };
+};
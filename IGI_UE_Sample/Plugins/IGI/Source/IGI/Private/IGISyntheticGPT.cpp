@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "IGISyntheticGPT.h"
+
+#include "IGILog.h"
+#include "IGISettings.h"
+
+#include "nvigi_gpt.h"
+
+#include <atomic>
+
+namespace IGISyntheticGPT
+{
+    const nvigi::PluginID kId = { { 0x6a1f93c2, 0x4d0e, 0x4b7a, { 0x9e, 0x51, 0x2c, 0x83, 0xf4, 0x17, 0xb6, 0x0d } }, 0x5e7d21 };
+}
+
+namespace
+{
+    // Words the responses are made of; one is a token. The last ones are not ASCII, so that marshaling sees multi-byte UTF-8.
+    constexpr const char* const SYNTHETIC_WORDS[]{ " the", " guard", " said", " that", " the", " road", " north", " is", " closed", ",", " traveller", ".", " caf\xc3\xa9", " na\xc3\xafve" };
+
+    struct FSyntheticInstanceData
+    {
+        nvigi::InferenceInstance Instance{};
+        std::atomic<uint32> NumEvaluations{ 0 };
+    };
+
+    nvigi::InferenceExecutionState Deliver(nvigi::InferenceExecutionContext* Context, const char* Text, nvigi::InferenceExecutionState State)
+    {
+        nvigi::InferenceDataTextSTLHelper TextData(Text);
+        nvigi::InferenceDataSlot Slot{ nvigi::kGPTDataSlotResponse, TextData };
+        nvigi::InferenceDataSlotArray Outputs{ 1, &Slot };
+
+        Context->outputs = &Outputs;
+        const nvigi::InferenceExecutionState Result = Context->callback(Context, State, Context->callbackUserData);
+        Context->outputs = nullptr;
+        return Result;
+    }
+
+    nvigi::Result Evaluate(nvigi::InferenceExecutionContext* Context)
+    {
+        if (Context == nullptr || Context->instance == nullptr || Context->callback == nullptr)
+        {
+            return nvigi::kResultInvalidParameter;
+        }
+
+        const UIGISettings* Settings = GetDefault<UIGISettings>();
+        FSyntheticInstanceData* Data = reinterpret_cast<FSyntheticInstanceData*>(Context->instance->data);
+        const uint32 Evaluation = Data->NumEvaluations++;
+
+        if (Settings->SyntheticPrefillMs > 0.0f)
+        {
+            FPlatformProcess::Sleep(Settings->SyntheticPrefillMs / 1000.0f);
+        }
+
+        // Fails mid-response, where a real backend fails in ways callers have to cope with
+        const bool bFail = FMath::FRand() < Settings->SyntheticFailureRate;
+        const int32 NumTokens = FMath::Max(0, Settings->SyntheticResponseTokens);
+        const int32 NumTokensBeforeFailure = bFail ? NumTokens / 2 : NumTokens;
+
+        for (int32 TokenIndex = 0; TokenIndex < NumTokensBeforeFailure; ++TokenIndex)
+        {
+            if (Settings->SyntheticMillisecondsPerToken > 0.0f)
+            {
+                FPlatformProcess::Sleep(Settings->SyntheticMillisecondsPerToken / 1000.0f);
+            }
+
+            const char* Word = SYNTHETIC_WORDS[(Evaluation + TokenIndex) % UE_ARRAY_COUNT(SYNTHETIC_WORDS)];
+            if (Deliver(Context, Word, nvigi::kInferenceExecutionStateDataPending) == nvigi::kInferenceExecutionStateCancel)
+            {
+                // Ends with Done like the GGML backend, which callers wait for before they let go of the context
+                Deliver(Context, "", nvigi::kInferenceExecutionStateDone);
+                return nvigi::kResultOk;
+            }
+        }
+
+        Deliver(Context, "", bFail ? nvigi::kInferenceExecutionStateInvalid : nvigi::kInferenceExecutionStateDone);
+        return bFail ? nvigi::kResultInvalidState : nvigi::kResultOk;
+    }
+
+    nvigi::Result CreateInstance(const nvigi::NVIGIParameter* /*Params*/, nvigi::InferenceInstance** OutInstance)
+    {
+        if (OutInstance == nullptr)
+        {
+            return nvigi::kResultInvalidParameter;
+        }
+
+        FSyntheticInstanceData* Data = new FSyntheticInstanceData();
+        Data->Instance.data = reinterpret_cast<nvigi::InferenceInstanceData*>(Data);
+        Data->Instance.evaluateAsync = &Evaluate;
+
+        *OutInstance = &Data->Instance;
+        return nvigi::kResultOk;
+    }
+
+    nvigi::Result DestroyInstance(const nvigi::InferenceInstance* Instance)
+    {
+        if (Instance != nullptr)
+        {
+            delete reinterpret_cast<FSyntheticInstanceData*>(Instance->data);
+        }
+        return nvigi::kResultOk;
+    }
+
+    nvigi::InferenceInterface* CreateInterface()
+    {
+        static nvigi::InferenceInterface Interface{};
+        Interface.createInstance = &CreateInstance;
+        Interface.destroyInstance = &DestroyInstance;
+        return &Interface;
+    }
+}
+
+bool IGISyntheticGPT::IsFeature(const nvigi::PluginID& Feature)
+{
+    return FMemory::Memcmp(&Feature, &kId, sizeof(nvigi::PluginID)) == 0;
+}
+
+nvigi::InferenceInterface* IGISyntheticGPT::GetInterface()
+{
+    static nvigi::InferenceInterface* Interface = CreateInterface();
+    return Interface;
+}
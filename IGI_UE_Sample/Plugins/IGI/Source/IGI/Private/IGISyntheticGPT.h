@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "nvigi.h"
+#include "nvigi_ai.h"
+
+/**
+ * Stand-in for the GGML GPT plugins that generates filler tokens instead of running a model, for measuring the plugin's own
+ * scheduling, streaming and marshaling overhead, and for stress tests on machines with no GPU and no model files.
+ * It implements the same nvigi::InferenceInterface and InferenceInstance the GPT code drives, and FIGIModule::LoadIGIFeature
+ * hands it out for its feature id without going through the nvigi core. Prefill delay, per-token latency, response length
+ * and failure rate come from the Synthetic category of UIGISettings. Selected with GPTBackend=Synthetic or -IGIGPTBackend=Synthetic.
+ *
+ * Evaluation runs on the calling thread and blocks it for the whole response, like the GGML backends, so requests in flight
+ * occupy the task graph workers EvaluateAsync runs them on. Unlike a model, an instance keeps no state per evaluation, so
+ * FIGIGPT does not serialize its requests: they overlap up to the number of workers, as on a server.
+ */
+namespace IGISyntheticGPT
+{
+    /** Feature id of the synthetic backend; not an nvigi plugin */
+    extern const nvigi::PluginID kId;
+
+    bool IsFeature(const nvigi::PluginID& Feature);
+
+    nvigi::InferenceInterface* GetInterface();
+}
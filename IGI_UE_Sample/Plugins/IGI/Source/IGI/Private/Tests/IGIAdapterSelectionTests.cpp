@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "Misc/AutomationTest.h"
+
+#include "IGIAdapterSelection.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Headless on any platform, e.g. on Linux:
+//   UnrealEditor-Cmd <project> -nullrhi -unattended -ExecCmds="Automation RunTests IGI.AdapterSelection; Quit"
+
+namespace
+{
+    constexpr uint32 VENDOR_NVIDIA{ 0x10DE };
+    constexpr uint32 VENDOR_AMD{ 0x1002 };
+    constexpr uint32 VENDOR_INTEL{ 0x8086 };
+
+    // Same members as nvigi::VendorId
+    enum class EMockVendor : uint32
+    {
+        eAny = 0,
+        eNone = 0xFFFFFFFF,
+        eNVDA = VENDOR_NVIDIA,
+    };
+
+    // Same members as LUID
+    struct FMockLuid
+    {
+        uint32 LowPart{ 0 };
+        int32 HighPart{ 0 };
+    };
+
+    FIGIAdapterInfo MakeAdapter(uint32 Vendor, uint32 Architecture, uint64 DedicatedMemoryMB, bool bIsRenderAdapter = false)
+    {
+        FIGIAdapterInfo Adapter;
+        Adapter.Vendor = Vendor;
+        Adapter.Architecture = Architecture;
+        Adapter.DedicatedMemoryMB = DedicatedMemoryMB;
+        Adapter.bIsPhysical = true;
+        Adapter.bIsRenderAdapter = bIsRenderAdapter;
+        return Adapter;
+    }
+
+    FIGIAdapterSelectionPolicy MakePolicy(EIGIAdapterSelection Selection, uint32 PreferredVendorId = 0, int32 AdapterIndex = 0, bool bAvoidRenderAdapter = false)
+    {
+        FIGIAdapterSelectionPolicy Policy;
+        Policy.Policy = Selection;
+        Policy.PreferredVendorId = PreferredVendorId;
+        Policy.AdapterIndex = AdapterIndex;
+        Policy.bAvoidRenderAdapter = bAvoidRenderAdapter;
+        return Policy;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIAdapterSelectionLuidTest, "IGI.AdapterSelection.LuidMatch",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIAdapterSelectionLuidTest::RunTest(const FString& /*Parameters*/)
+{
+    TestTrue(TEXT("Same LUID"), IsSameIGIAdapterLuid(FMockLuid{ 0x1234, 1 }, FMockLuid{ 0x1234, 1 }));
+    TestFalse(TEXT("Other low part"), IsSameIGIAdapterLuid(FMockLuid{ 0x1234, 1 }, FMockLuid{ 0x1235, 1 }));
+    TestFalse(TEXT("Other high part"), IsSameIGIAdapterLuid(FMockLuid{ 0x1234, 1 }, FMockLuid{ 0x1234, 2 }));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIAdapterSelectionVendorTest, "IGI.AdapterSelection.VendorFilter",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIAdapterSelectionVendorTest::RunTest(const FString& /*Parameters*/)
+{
+    // An iGPU of a newer architecture next to an older dGPU
+    const TArray<FIGIAdapterInfo> Adapters{ MakeAdapter(VENDOR_INTEL, 12, 128), MakeAdapter(VENDOR_NVIDIA, 8, 8192), MakeAdapter(VENDOR_AMD, 10, 16384) };
+
+    TestEqual(TEXT("Highest architecture"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::HighestArchitecture)), 0);
+    TestEqual(TEXT("Most video memory"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::MostVideoMemory)), 2);
+    TestEqual(TEXT("Preferred vendor"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::PreferredVendor, VENDOR_NVIDIA)), 1);
+    TestEqual(TEXT("Adapter index"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::AdapterIndex, 0, 2)), 2);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIAdapterSelectionPhysicalTest, "IGI.AdapterSelection.PhysicalVendor",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIAdapterSelectionPhysicalTest::RunTest(const FString& /*Parameters*/)
+{
+    TestTrue(TEXT("Hardware vendor"), IsPhysicalIGIAdapterVendor(EMockVendor::eNVDA));
+    TestFalse(TEXT("Any vendor"), IsPhysicalIGIAdapterVendor(EMockVendor::eAny));
+    TestFalse(TEXT("No vendor"), IsPhysicalIGIAdapterVendor(EMockVendor::eNone));
+
+    // A placeholder is never picked over hardware, whatever it reports
+    TArray<FIGIAdapterInfo> Adapters{ MakeAdapter(0, 99, 99999), MakeAdapter(VENDOR_NVIDIA, 8, 8192) };
+    Adapters[0].bIsPhysical = false;
+    TestEqual(TEXT("Hardware over placeholder"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::HighestArchitecture)), 1);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIAdapterSelectionFallbackTest, "IGI.AdapterSelection.Fallback",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIAdapterSelectionFallbackTest::RunTest(const FString& /*Parameters*/)
+{
+    TestEqual(TEXT("No adapter"), SelectIGIAdapter({}, MakePolicy(EIGIAdapterSelection::HighestArchitecture)), static_cast<int32>(INDEX_NONE));
+
+    TArray<FIGIAdapterInfo> Placeholders{ MakeAdapter(0, 0, 0), MakeAdapter(0, 0, 0) };
+    Placeholders[0].bIsPhysical = false;
+    Placeholders[1].bIsPhysical = false;
+    TestEqual(TEXT("No physical adapter"), SelectIGIAdapter(Placeholders, MakePolicy(EIGIAdapterSelection::HighestArchitecture)), 0);
+
+    const TArray<FIGIAdapterInfo> Adapters{ MakeAdapter(VENDOR_INTEL, 12, 128), MakeAdapter(VENDOR_AMD, 10, 16384) };
+    TestEqual(TEXT("Preferred vendor absent"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::PreferredVendor, VENDOR_NVIDIA)), 0);
+    TestEqual(TEXT("Adapter index out of range"), SelectIGIAdapter(Adapters, MakePolicy(EIGIAdapterSelection::AdapterIndex, 0, 5)), 0);
+
+    // Avoiding the render adapter only applies when there is another one
+    const TArray<FIGIAdapterInfo> RenderOnly{ MakeAdapter(VENDOR_NVIDIA, 8, 8192, true) };
+    TestEqual(TEXT("Only the render adapter"), SelectIGIAdapter(RenderOnly, MakePolicy(EIGIAdapterSelection::HighestArchitecture, 0, 0, true)), 0);
+
+    const TArray<FIGIAdapterInfo> DualGPU{ MakeAdapter(VENDOR_NVIDIA, 9, 16384, true), MakeAdapter(VENDOR_NVIDIA, 8, 8192) };
+    TestEqual(TEXT("Secondary adapter"), SelectIGIAdapter(DualGPU, MakePolicy(EIGIAdapterSelection::HighestArchitecture, 0, 0, true)), 1);
+    return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "Misc/AutomationTest.h"
+
+#include "IGIContextComponent.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Headless on any platform, e.g. on Linux:
+//   UnrealEditor-Cmd <project> -nullrhi -unattended -ExecCmds="Automation RunTests IGI.Context; Quit"
+
+namespace
+{
+    const FName CATEGORY_LOCATION{ TEXT("Location") };
+    const FName CATEGORY_INVENTORY{ TEXT("Inventory") };
+    const FName CATEGORY_QUEST{ TEXT("Quest") };
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIContextOrderTest, "IGI.Context.StableOrder",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIContextOrderTest::RunTest(const FString& /*Parameters*/)
+{
+    UIGIContextComponent* Context = NewObject<UIGIContextComponent>();
+
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("keep"));
+    Context->SetField(CATEGORY_INVENTORY, TEXT("gold"), TEXT("12"));
+    Context->SetField(CATEGORY_LOCATION, TEXT("time"), TEXT("dusk"));
+    TestEqual(TEXT("Categories and keys in first-set order"), Context->BuildContext(), FString(TEXT("Location: zone=keep, time=dusk\nInventory: gold=12")));
+
+    // Changing a value keeps its place, so that the prompt prefix before it stays the same
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("gate"));
+    Context->SetIntField(CATEGORY_INVENTORY, TEXT("gold"), 9);
+    TestEqual(TEXT("Changed values in place"), Context->BuildContext(), FString(TEXT("Location: zone=gate, time=dusk\nInventory: gold=9")));
+
+    // A category emptied of its fields keeps its place too, without a line
+    Context->RemoveField(CATEGORY_LOCATION, TEXT("zone"));
+    Context->RemoveField(CATEGORY_LOCATION, TEXT("time"));
+    TestEqual(TEXT("Empty category omitted"), Context->BuildContext(), FString(TEXT("Inventory: gold=9")));
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("keep"));
+    TestEqual(TEXT("Empty category refilled in place"), Context->BuildContext(), FString(TEXT("Location: zone=keep\nInventory: gold=9")));
+
+    // A removed category is set again last
+    Context->RemoveCategory(CATEGORY_LOCATION);
+    Context->SetField(CATEGORY_QUEST, TEXT("step"), TEXT("2"));
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("keep"));
+    TestEqual(TEXT("Removed category set again last"), Context->BuildContext(), FString(TEXT("Inventory: gold=9\nQuest: step=2\nLocation: zone=keep")));
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIContextDirtyTest, "IGI.Context.DirtyTracking",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIContextDirtyTest::RunTest(const FString& /*Parameters*/)
+{
+    UIGIContextComponent* Context = NewObject<UIGIContextComponent>();
+
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("keep"));
+    Context->SetField(CATEGORY_INVENTORY, TEXT("gold"), TEXT("12"));
+    Context->BuildContext();
+    TestEqual(TEXT("Every category serialized at first"), Context->GetStats().NumFragmentsSerialized, 2ull);
+    TestEqual(TEXT("One build"), Context->GetStats().NumBuilds, 1ull);
+
+    // Same values: nothing to rebuild
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("keep"));
+    Context->SetIntField(CATEGORY_INVENTORY, TEXT("gold"), 12);
+    Context->BuildContext();
+    TestEqual(TEXT("Same values serialize nothing"), Context->GetStats().NumFragmentsSerialized, 2ull);
+    TestEqual(TEXT("Same values reuse the context"), Context->GetStats().NumBuilds, 1ull);
+
+    // Values compare case-sensitively, as the model sees the difference
+    Context->SetField(CATEGORY_LOCATION, TEXT("zone"), TEXT("Keep"));
+    Context->BuildContext();
+    TestEqual(TEXT("Only the changed category serialized"), Context->GetStats().NumFragmentsSerialized, 3ull);
+    TestEqual(TEXT("Rebuilt once"), Context->GetStats().NumBuilds, 2ull);
+
+    Context->RemoveField(CATEGORY_INVENTORY, TEXT("gold"));
+    Context->RemoveField(CATEGORY_INVENTORY, TEXT("silver"));
+    Context->BuildContext();
+    TestEqual(TEXT("Removed field serializes its category"), Context->GetStats().NumFragmentsSerialized, 4ull);
+
+    Context->RemoveCategory(CATEGORY_QUEST);
+    Context->BuildContext();
+    TestEqual(TEXT("Removing a missing category rebuilds nothing"), Context->GetStats().NumBuilds, 3ull);
+
+    Context->RemoveCategory(CATEGORY_INVENTORY);
+    TestEqual(TEXT("Removed category gone"), Context->BuildContext(), FString(TEXT("Location: zone=Keep")));
+    TestEqual(TEXT("Clean categories are not serialized again"), Context->GetStats().NumFragmentsSerialized, 4ull);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGIContextFloatTest, "IGI.Context.FloatRounding",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGIContextFloatTest::RunTest(const FString& /*Parameters*/)
+{
+    UIGIContextComponent* Context = NewObject<UIGIContextComponent>();
+
+    Context->SetFloatField(CATEGORY_LOCATION, TEXT("distance"), 12.34f);
+    TestEqual(TEXT("One decimal by default"), Context->BuildContext(), FString(TEXT("Location: distance=12.3")));
+
+    // Below the precision, a change does not dirty the context
+    const uint64 NumSerialized = Context->GetStats().NumFragmentsSerialized;
+    Context->SetFloatField(CATEGORY_LOCATION, TEXT("distance"), 12.31f);
+    Context->BuildContext();
+    TestEqual(TEXT("Change below the precision ignored"), Context->GetStats().NumFragmentsSerialized, NumSerialized);
+
+    Context->SetFloatField(CATEGORY_LOCATION, TEXT("distance"), 12.36f);
+    TestEqual(TEXT("Change at the precision rounded"), Context->BuildContext(), FString(TEXT("Location: distance=12.4")));
+
+    Context->SetFloatField(CATEGORY_LOCATION, TEXT("distance"), 12.6f, 0);
+    TestEqual(TEXT("No decimals"), Context->BuildContext(), FString(TEXT("Location: distance=13")));
+
+    Context->SetFloatField(CATEGORY_LOCATION, TEXT("distance"), 0.5f, 10);
+    TestEqual(TEXT("Precision capped at six decimals"), Context->BuildContext(), FString(TEXT("Location: distance=0.500000")));
+    return true;
+}
+
+#endif
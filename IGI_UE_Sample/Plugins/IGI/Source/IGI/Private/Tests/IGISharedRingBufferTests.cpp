@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#include "Misc/AutomationTest.h"
+
+#include "IGISharedRingBuffer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Headless on any platform, e.g. on Linux:
+//   UnrealEditor-Cmd <project> -nullrhi -unattended -ExecCmds="Automation RunTests IGI.SharedRingBuffer; Quit"
+
+namespace
+{
+    // Room for two records of 24 bytes, or three of 16, with 8 bytes of header each
+    constexpr uint64 TEST_CAPACITY{ 64 };
+
+    // Producer and consumer in one process, on memory a shared region would provide
+    struct FTestRing
+    {
+        FTestRing()
+        {
+            Memory = FMemory::Malloc(FIGISharedRingBuffer::GetRequiredSize(TEST_CAPACITY), PLATFORM_CACHE_LINE_SIZE);
+            Producer.Initialize(Memory, TEST_CAPACITY);
+            Consumer.Attach(Memory, TEST_CAPACITY);
+        }
+
+        ~FTestRing()
+        {
+            FMemory::Free(Memory);
+        }
+
+        bool Write(uint32 PayloadSize, uint8 Value, uint8** OutPayload = nullptr)
+        {
+            uint8* Payload = Producer.BeginWrite(PayloadSize);
+            if (Payload == nullptr)
+            {
+                return false;
+            }
+
+            FMemory::Memset(Payload, Value, PayloadSize);
+            Producer.EndWrite();
+            if (OutPayload != nullptr)
+            {
+                *OutPayload = Payload;
+            }
+            return true;
+        }
+
+        // Size and first byte of the oldest record, which is released; -1 when the ring is empty, and for the byte of an empty record
+        int32 Read(int32& OutValue, const uint8** OutPayload = nullptr)
+        {
+            TConstArrayView<uint8> Payload;
+            if (!Consumer.BeginRead(Payload))
+            {
+                return -1;
+            }
+
+            OutValue = Payload.Num() > 0 ? Payload[0] : -1;
+            if (OutPayload != nullptr)
+            {
+                *OutPayload = Payload.GetData();
+            }
+            Consumer.EndRead();
+            return Payload.Num();
+        }
+
+        void* Memory{ nullptr };
+        FIGISharedRingBuffer Producer;
+        FIGISharedRingBuffer Consumer;
+    };
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGISharedRingBufferRoundTripTest, "IGI.SharedRingBuffer.RoundTrip",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGISharedRingBufferRoundTripTest::RunTest(const FString& /*Parameters*/)
+{
+    FTestRing Ring;
+    int32 Value{ 0 };
+
+    TestEqual(TEXT("Empty at first"), Ring.Read(Value), -1);
+
+    TestTrue(TEXT("First write"), Ring.Write(5, 0xA1));
+    TestTrue(TEXT("Second write"), Ring.Write(0, 0xB2));
+
+    TestEqual(TEXT("First record size"), Ring.Read(Value), 5);
+    TestEqual(TEXT("First record contents"), Value, 0xA1);
+    TestEqual(TEXT("Empty record size"), Ring.Read(Value), 0);
+    TestEqual(TEXT("Empty once read"), Ring.Read(Value), -1);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGISharedRingBufferWrapTest, "IGI.SharedRingBuffer.WrapWithPadding",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGISharedRingBufferWrapTest::RunTest(const FString& /*Parameters*/)
+{
+    FTestRing Ring;
+    int32 Value{ 0 };
+
+    // Records of 24 bytes at offsets 0 and 24; the third would straddle the end at 48
+    uint8* Start{ nullptr };
+    for (uint8 Index = 0; Index < 2; ++Index)
+    {
+        TestTrue(TEXT("Write before the end"), Ring.Write(16, Index, (Index == 0) ? &Start : nullptr));
+        TestEqual(TEXT("Read before the end"), Ring.Read(Value), 16);
+        TestEqual(TEXT("Contents before the end"), Value, static_cast<int32>(Index));
+    }
+
+    uint8* Written{ nullptr };
+    TestTrue(TEXT("Write across the end"), Ring.Write(16, 0xC3, &Written));
+    TestTrue(TEXT("Written at the start of the ring"), Written == Start);
+
+    const uint8* Read{ nullptr };
+    TestEqual(TEXT("Padding skipped"), Ring.Read(Value, &Read), 16);
+    TestEqual(TEXT("Contents after the padding"), Value, 0xC3);
+    TestTrue(TEXT("Read in place, where it was written"), Read == Written);
+    TestEqual(TEXT("Empty after the wrap"), Ring.Read(Value), -1);
+
+    // The indices keep growing past the capacity
+    TestTrue(TEXT("Write after the wrap"), Ring.Write(8, 0xD4));
+    TestEqual(TEXT("Read after the wrap"), Ring.Read(Value), 8);
+    TestEqual(TEXT("Contents after the wrap"), Value, 0xD4);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGISharedRingBufferFullTest, "IGI.SharedRingBuffer.Full",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGISharedRingBufferFullTest::RunTest(const FString& /*Parameters*/)
+{
+    FTestRing Ring;
+    int32 Value{ 0 };
+
+    TestTrue(TEXT("First record"), Ring.Write(24, 1));
+    TestTrue(TEXT("Second record"), Ring.Write(24, 2));
+    TestFalse(TEXT("No room for a third"), Ring.Write(1, 3));
+
+    TestEqual(TEXT("Oldest first"), Ring.Read(Value), 24);
+    TestEqual(TEXT("Oldest contents"), Value, 1);
+    TestTrue(TEXT("Room again once read"), Ring.Write(24, 3));
+
+    // 24 bytes used from offset 16 and 40 free, enough for a record of 32 but not for it and the 24 bytes of padding before it
+    FTestRing Padded;
+    TestTrue(TEXT("Record at the start"), Padded.Write(8, 1));
+    TestTrue(TEXT("Record in the middle"), Padded.Write(16, 2));
+    TestEqual(TEXT("Record at the start read"), Padded.Read(Value), 8);
+    TestFalse(TEXT("No room for a record and its padding"), Padded.Write(24, 3));
+
+    TestEqual(TEXT("Record in the middle read"), Padded.Read(Value), 16);
+    TestTrue(TEXT("Room for both once drained"), Padded.Write(24, 3));
+    TestEqual(TEXT("Record after the padding read"), Padded.Read(Value), 24);
+    TestEqual(TEXT("Record after the padding contents"), Value, 3);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIGISharedRingBufferMaxPayloadTest, "IGI.SharedRingBuffer.MaxPayload",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIGISharedRingBufferMaxPayloadTest::RunTest(const FString& /*Parameters*/)
+{
+    FTestRing Ring;
+    int32 Value{ 0 };
+
+    // Half the ring less a header, so that a record always fits once the ring is drained, padding included
+    TestEqual(TEXT("Max payload size"), Ring.Producer.GetMaxPayloadSize(), TEST_CAPACITY / 2 - 8);
+
+    TestFalse(TEXT("Oversized payload rejected on an empty ring"), Ring.Write(static_cast<uint32>(Ring.Producer.GetMaxPayloadSize() + 1), 1));
+    TestEqual(TEXT("Nothing written for it"), Ring.Read(Value), -1);
+
+    TestTrue(TEXT("Max payload accepted"), Ring.Write(static_cast<uint32>(Ring.Producer.GetMaxPayloadSize()), 2));
+    TestEqual(TEXT("Max payload read"), Ring.Read(Value), static_cast<int32>(Ring.Producer.GetMaxPayloadSize()));
+    TestEqual(TEXT("Max payload contents"), Value, 2);
+    return true;
+}
+
+#endif
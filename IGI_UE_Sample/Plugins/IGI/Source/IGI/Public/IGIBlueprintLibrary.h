@@ -7,11 +7,17 @@
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintAsyncActionBase.h"
 
-#include <atomic>
 #include "IGIBlueprintLibrary.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FIGIGPTEvaluateAsyncOutputPin, FString, Response);
 
+/**
+ * Blueprint async node for GPT requests.
+ * Nodes are pooled: they stay rooted for the lifetime of the process and are handed out again once their response
+ * has been broadcast, so a request does not allocate a UObject nor create work for the garbage collector.
+ * Do not keep a reference to the node after OnResponse has fired; it may already be serving another request.
+ * Any number of nodes may be in flight; FIGIGPT queues their requests.
+ */
 UCLASS(BlueprintType, meta = (ExposedAsyncProxy = AsyncAction))
 class IGI_API UIGIGPTEvaluateAsync : public UBlueprintAsyncActionBase
 {
@@ -21,6 +27,24 @@ public:
     UFUNCTION(BlueprintCallable, Category = "IGI|GPT", meta = (DisplayName = "Send text to GPT (Async)", BlueprintInternalUseOnly = "true"))
     static UIGIGPTEvaluateAsync* GPTEvaluateAsync(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt);
 
+    /**
+     * Call on every change of the text the player is typing, with the prompts it will be sent with. The draft is evaluated
+     * ahead of time while the GPT is idle, so that sending the same prompts only waits for what is left of the response.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IGI|GPT", meta = (DisplayName = "Update GPT draft"))
+    static void UpdateGPTDraft(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt);
+
+    /** Call when the player abandons the text, e.g. when the chat box closes */
+    UFUNCTION(BlueprintCallable, Category = "IGI|GPT", meta = (DisplayName = "Clear GPT draft"))
+    static void ClearGPTDraft();
+
+    /**
+     * Call for prompts likely to be sent soon, e.g. the greeting of an NPC the player approaches. They are generated while the
+     * GPT is idle, so that sending them within ExpirySeconds responds at once; higher Priority first.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IGI|GPT", meta = (DisplayName = "Anticipate GPT request"))
+    static void AnticipateGPTRequest(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt, float ExpirySeconds = 30.0f, int32 Priority = 0);
+
     UPROPERTY(BlueprintAssignable)
     FIGIGPTEvaluateAsyncOutputPin OnResponse;
 
@@ -33,8 +57,35 @@ public:
     UPROPERTY(BlueprintReadOnly, Category = "IGI|GPT", meta = (BBlueprintInternalUseOnly = "true"))
     FString AssistantPrompt;
 
+    /** Pool statistics, for the IGI.GPT.PoolStats and IGI.GPT.PoolStress console commands */
+    struct FPoolStats
+    {
+        uint64 NumRequests{ 0 };
+
+        /** Nodes handed back to the pool, whether they responded or had nothing to send */
+        uint64 NumReleases{ 0 };
+        uint64 NumAllocations{ 0 };
+
+        /** Garbage collections the engine ran; StressPool leaves out those it forces */
+        uint64 NumGarbageCollections{ 0 };
+        int32 NumFree{ 0 };
+    };
+    static FPoolStats GetPoolStats();
+
+    /**
+     * Activates NumRequests nodes, NumInFlight at a time, across frames, forcing a garbage collection every
+     * FramesPerGarbageCollection frames, and calls OnDone with the stats delta once all have responded. The requests go to
+     * the GPT; run with -IGIGPTBackend=Synthetic to measure the pool without a model.
+     */
+    static void StressPool(int32 NumRequests, int32 NumInFlight, int32 FramesPerGarbageCollection, TFunction<void(const FPoolStats&)>&& OnDone);
+
+    /** Unroots the free nodes, at module shutdown; nodes still in flight are unrooted once they respond */
+    static void EmptyPool();
+
 private:
     virtual void Activate() override;
 
-    static std::atomic<bool> IsRunning;
+    /** Game thread only */
+    static UIGIGPTEvaluateAsync* AcquireFromPool();
+    void ReleaseToPool();
 };
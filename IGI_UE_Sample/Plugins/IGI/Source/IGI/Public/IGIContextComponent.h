@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "IGIContextComponent.generated.h"
+
+/**
+ * Game state context for GPT prompts. Actors and components set compact fields (category, key, value) on it as their
+ * state changes, rather than describing the whole world in prose for every request. Each category keeps its serialized
+ * fragment until one of its fields actually changes, so building the context only re-serializes dirty categories.
+ *
+ * The context is one line per category, "Category: key=value, key=value", in the order categories were first set and
+ * keys in the order they were first set within their category. Setting slow-changing categories first keeps consecutive
+ * prompts sharing the longest possible prefix.
+ *
+ * Game thread only.
+ */
+UCLASS(ClassGroup = (IGI), meta = (BlueprintSpawnableComponent))
+class IGI_API UIGIContextComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UIGIContextComponent();
+
+    /** Sets a field; the category is only re-serialized if the value differs from the current one */
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context")
+    void SetField(FName Category, FName Key, const FString& Value);
+
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context")
+    void SetIntField(FName Category, FName Key, int32 Value);
+
+    /** Rounded to Precision decimals, so that changes too small to matter to the model do not dirty the context */
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context")
+    void SetFloatField(FName Category, FName Key, float Value, int32 Precision = 1);
+
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context")
+    void RemoveField(FName Category, FName Key);
+
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context")
+    void RemoveCategory(FName Category);
+
+    /** The context, rebuilt from the cached fragments of clean categories and the re-serialized dirty ones */
+    const FString& BuildContext();
+
+    UFUNCTION(BlueprintCallable, Category = "IGI|Context", meta = (DisplayName = "Build Context"))
+    FString K2_BuildContext() { return BuildContext(); }
+
+    struct FStats
+    {
+        uint64 NumBuilds{ 0 };
+        uint64 NumFragmentsSerialized{ 0 };
+        double LastBuildMicroseconds{ 0.0 };
+    };
+    const FStats& GetStats() const { return Stats; }
+
+private:
+    struct FField
+    {
+        FName Key;
+        FString Value;
+    };
+
+    struct FCategory
+    {
+        FName Name;
+        TArray<FField> Fields;
+        FString Fragment;
+        bool bDirty{ true };
+    };
+
+    FCategory* FindCategory(FName Category);
+
+    TArray<FCategory> Categories;
+    FString Context;
+    bool bDirty{ false };
+
+    FStats Stats;
+};
@@ -5,19 +5,158 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/Ticker.h"
 #include "Templates/PimplPtr.h"
 
 #include "IGIModule.h"
 
+#include <atomic>
+
+/** Prompts for a single GPT request. Meant to be moved into EvaluateAsync rather than copied. */
+struct FIGIGPTRequest
+{
+    FString SystemPrompt;
+    FString UserPrompt;
+    FString AssistantPrompt;
+
+    /** LoRA adapter applied on top of the base model for this request, e.g. an NPC persona; none for the base model */
+    FName Adapter;
+
+    /** Sampling seed, for reproducible responses from a given model; -1 for a random one. Honored by the in-process host. */
+    int32 Seed{ -1 };
+
+    /** Whether Other would be evaluated the same; prompts compare case-sensitively */
+    bool Matches(const FIGIGPTRequest& Other) const
+    {
+        return SystemPrompt.Equals(Other.SystemPrompt, ESearchCase::CaseSensitive)
+            && UserPrompt.Equals(Other.UserPrompt, ESearchCase::CaseSensitive)
+            && AssistantPrompt.Equals(Other.AssistantPrompt, ESearchCase::CaseSensitive)
+            && Adapter == Other.Adapter
+            && Seed == Other.Seed;
+    }
+};
+
+/**
+ * GPT feature. The base class hosts the model in this process through nvigi; subclasses forward the same API to a
+ * model hosted elsewhere (see FIGIModule::GetGPT).
+ */
 class IGI_API FIGIGPT
 {
 public:
+    using FResponseCallback = TUniqueFunction<void(FString&& Response)>;
+
+    /** Called on the evaluating thread for each chunk of generated text. Returning false cancels the request. */
+    using FTokenCallback = TFunction<bool(const FString& Token)>;
+
     FIGIGPT(FIGIModule* IGIModule);
     virtual ~FIGIGPT();
 
     FString Evaluate(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt);
+    FString Evaluate(const FIGIGPTRequest& Request);
+
+    /** Blocks until the response is complete, streaming it to OnToken on the way. Recorded while a trace is (see IGI.Trace.Start). */
+    FString Evaluate(const FIGIGPTRequest& Request, const FTokenCallback& OnToken);
+
+    /**
+     * Evaluates the request on a background thread and calls OnResponse on the game thread. Does not create any UObject.
+     * Requests baked ahead of time (see UIGIBakeDialogueCommandlet) or generated in idle time (see FIGIPregeneration) are
+     * answered without running the model; others abandon pre-generation so that they do not wait for it.
+     */
+    void EvaluateAsync(FIGIGPTRequest&& Request, FResponseCallback&& OnResponse);
+
+    /** Same, streaming the response to OnToken on the background thread on the way; a response ready beforehand comes as one token */
+    void EvaluateAsync(FIGIGPTRequest&& Request, FTokenCallback&& OnToken, FResponseCallback&& OnResponse);
+
+    /**
+     * Evaluates the request at the lowest priority, for upkeep such as history summaries: only once no other request, draft
+     * or pre-generation is pending, and without abandoning or cancelling any of them. Calls OnResponse on the game thread.
+     * Game thread only.
+     */
+    void EvaluateWhenIdle(FIGIGPTRequest&& Request, FResponseCallback&& OnResponse);
+
+    /**
+     * Evaluates the request on a background thread for speculative work such as FIGIPregeneration, which checks IsIdle
+     * itself: it neither counts as a pending request nor abandons anything. Calls OnResponse on the game thread.
+     * Game thread only.
+     */
+    void EvaluateSpeculatively(FIGIGPTRequest&& Request, FTokenCallback&& OnToken, FResponseCallback&& OnResponse);
+
+    /**
+     * Request the player is still composing, e.g. from the text-changed event of a chat box. Once it has stayed the same
+     * for DraftDebounceSeconds and no other request is pending, it is evaluated ahead of time; EvaluateAsync with the
+     * same request then takes that evaluation over where it got to instead of starting again. Another draft, or another
+     * request, cancels it. Game thread only, like EvaluateAsync.
+     */
+    void UpdateDraft(const FIGIGPTRequest& Draft);
+
+    /** Drops the draft, cancelling its evaluation unless EvaluateAsync has taken it over */
+    void ClearDraft();
+
+    /** Estimated number of tokens Text takes in the model's context; exact but for letters. See FIGIPromptBuilder. */
+    static int32 CountTokens(FStringView Text);
+
+    /** Size of the model's context window, in tokens; prompt and response must both fit in it */
+    static int32 GetContextSize();
+
+    /** Maximum number of tokens generated for a single response */
+    static int32 GetMaxTokensToPredict();
+
+    /** Model the GPT runs, for state that only makes sense with the same weights; empty when unknown */
+    virtual FString GetModelGUID() const;
+
+    /** Inference backend the GPT runs on, e.g. ggml.cuda; empty when unknown */
+    virtual FString GetBackendName() const;
+
+    /** Whether no request from EvaluateAsync or EvaluateWhenIdle is pending, so that the GPT can be released */
+    bool IsIdle() const { return NumPendingRequests.load() == 0 && NumDraftRequests.load() == 0 && IdleRequests.IsEmpty(); }
+
+    /**
+     * Cancels every evaluation in flight at its next token, drops the requests not started yet, and blocks until the
+     * background threads are done with this GPT, so that it can be destroyed. Evaluations after this return at once.
+     * Game thread only.
+     */
+    void CancelAndWait();
+
+protected:
+    /** For subclasses that do not host the model in this process */
+    FIGIGPT();
+
+    /** Evaluates a request wherever the model is hosted; Evaluate wraps it */
+    virtual FString EvaluateRequest(const FIGIGPTRequest& Request, const FTokenCallback& OnToken);
 
 private:
+    struct FDraftEvaluation;
+
+    struct FIdleRequest
+    {
+        FIGIGPTRequest Request;
+        FResponseCallback OnResponse;
+    };
+
+    bool TickIdleRequests(float DeltaTime);
+
+    bool TickDraft(float DeltaTime);
+    void SetDraft(FIGIGPTRequest&& Draft);
+    void CancelDraftEvaluation();
+
+    /** Hands the draft's evaluation over to the callbacks when it evaluates Request; false when it does not */
+    bool AdoptDraftEvaluation(const FIGIGPTRequest& Request, FTokenCallback& OnToken, FResponseCallback& OnResponse);
+
     class Impl;
     TPimplPtr<class Impl> Pimpl;
+
+    std::atomic<int32> NumPendingRequests{ 0 };
+    std::atomic<int32> NumSpeculativeRequests{ 0 };
+    std::atomic<bool> bCancellingAll{ false };
+
+    /** Draft waiting for DraftDebounceSeconds to pass, and the evaluation of the last draft that did */
+    TOptional<FIGIGPTRequest> PendingDraft;
+    double PendingDraftSeconds{ 0.0 };
+    TSharedPtr<FDraftEvaluation, ESPMode::ThreadSafe> DraftEvaluation;
+    FTSTicker::FDelegateHandle DraftTickHandle;
+    std::atomic<int32> NumDraftRequests{ 0 };
+
+    /** Requests from EvaluateWhenIdle not started yet; game thread only */
+    TArray<FIdleRequest> IdleRequests;
+    FTSTicker::FDelegateHandle IdleTickHandle;
 };
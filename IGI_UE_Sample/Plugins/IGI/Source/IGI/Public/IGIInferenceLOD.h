@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGIGPT.h"
+#include "IGISettings.h"
+
+#include <atomic>
+
+/** What the player can perceive of a speaker, from which FIGIInferenceLOD derives a relevance */
+struct FIGIInferenceRelevance
+{
+    /** Distance from the speaker to the player, in cm */
+    float Distance{ 0.0f };
+
+    /** Whether the speaker is on screen */
+    bool bVisible{ true };
+
+    /** Whether the player is talking to the speaker; always the most relevant */
+    bool bInConversation{ false };
+};
+
+/**
+ * Inference level of detail. Requests carry the relevance of their speaker, which selects a tier of UIGISettings::InferenceLODTiers:
+ * whether the response is generated, cached or canned, how many tokens it may take, whether the speaker's LoRA adapter applies
+ * and how the request is ordered against others. Requests of the tiers below the highest priority also share
+ * InferenceTokensPerSecond; once it is spent they fall back to the cache and to their canned text, so total inference load
+ * follows what the player can perceive rather than how many NPCs are talking.
+ *
+ * Requests are evaluated one at a time, highest priority first, through FIGIModule::GetGPT, so whatever the host mode the
+ * model never works on a background line while a conversation waits. Game thread only.
+ */
+class IGI_API FIGIInferenceLOD
+{
+public:
+    FIGIInferenceLOD();
+
+    /** Pending requests are dropped without a response; the request being evaluated is cancelled */
+    ~FIGIInferenceLOD();
+
+    /** 1 in conversation, otherwise falling with distance between RelevanceNearDistance and RelevanceFarDistance, halved off screen */
+    static float ComputeRelevance(const FIGIInferenceRelevance& Relevance);
+
+    /** Tier serving requests of this relevance */
+    static const FIGIInferenceLODTier& SelectTier(float Relevance);
+
+    /**
+     * Serves Request as the tier of Relevance says, and calls OnResponse on the game thread with the response, or with
+     * CannedResponse when the tier or the budget do not allow generating one.
+     */
+    void Submit(FIGIGPTRequest&& Request, const FIGIInferenceRelevance& Relevance, FString&& CannedResponse, FIGIGPT::FResponseCallback&& OnResponse);
+
+    struct FStats
+    {
+        int32 NumGenerated{ 0 };
+        int32 NumCached{ 0 };
+        int32 NumCanned{ 0 };
+
+        /** Requests a tier would have generated, served from the cache or canned text for lack of budget or queue room */
+        int32 NumDegraded{ 0 };
+
+        int64 NumTokensGenerated{ 0 };
+        int32 NumQueued{ 0 };
+    };
+    FStats GetStats() const;
+
+private:
+    struct FPendingRequest
+    {
+        FIGIGPTRequest Request;
+        FString CannedResponse;
+        FIGIGPT::FResponseCallback OnResponse;
+        uint32 CacheKey{ 0 };
+        EIGIInferenceSource Source{ EIGIInferenceSource::Generate };
+        int32 MaxTokens{ 0 };
+        int32 Priority{ 0 };
+        uint64 Sequence{ 0 };
+    };
+
+    struct FCachedResponse
+    {
+        /** Keys are hashes, which collide and ignore case; a hit must match the request itself */
+        FIGIGPTRequest Request;
+        FString Text;
+
+        /** Token limit it was generated with; 0 for the model's */
+        int32 MaxTokens{ 0 };
+        uint64 LastUse{ 0 };
+    };
+
+    /** Answers from the cache when there is a response to the same prompt, as long as the tier's unless bAnyLength */
+    bool TryRespondFromCache(FPendingRequest& Pending, bool bAnyLength);
+
+    /** Serves a request that will not be generated: from the cache when the source allows it, canned otherwise */
+    void RespondWithoutGenerating(FPendingRequest&& Pending, bool bDegraded);
+
+    void Respond(FIGIGPT::FResponseCallback&& OnResponse, FString&& Response);
+
+    void DispatchNext();
+    void Generate(FIGIGPT* GPT, FPendingRequest&& Pending);
+    void OnGenerated(FPendingRequest&& Pending, FString&& Response, int32 NumTokens);
+
+    /** Whether the token budget allows a request of this priority to generate */
+    bool HasTokenBudget(int32 Priority);
+
+    TArray<FPendingRequest> Queue;
+    bool bGenerating{ false };
+    uint64 NextSequence{ 0 };
+
+    TMap<uint32, FCachedResponse> Cache;
+    uint64 CacheClock{ 0 };
+
+    double TokenBucket{ 0.0 };
+    double TokenBucketTime{ 0.0 };
+
+    FStats Stats;
+
+    // Cleared on destruction, for the callbacks of the request being evaluated
+    TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> bAlive;
+};
@@ -7,6 +7,9 @@
 #include "IGIPlatformRHI.h"
 
 class FIGIGPT;
+struct FIGIGPTRequest;
+class FIGIInferenceLOD;
+class FIGIPregeneration;
 
 // These replicate some of the types defined in nvigi.h
 namespace nvigi
@@ -32,11 +35,18 @@ public:
 
     bool LoadIGICore();
     bool UnloadIGICore();
+    bool IsIGICoreLoaded() const;
 
     nvigi::Result LoadIGIFeature(const nvigi::PluginID& Feature, nvigi::InferenceInterface** Interface, const UTF8CHAR* UTF8PathToPlugin = nullptr);
     nvigi::Result UnloadIGIFeature(const nvigi::PluginID& Feature, nvigi::InferenceInterface* Interface);
     nvigi::Result CheckPluginCompatibility(const nvigi::PluginID& Feature, const FString& Name);
 
+    /** Whether the inference adapter is the render adapter; compute in graphics (CiG) is only possible when it is */
+    bool IsInferenceOnRenderAdapter() const;
+
+    /** Video memory still available to this process on the inference adapter, in MB */
+    uint64 GetInferenceAdapterFreeMemoryMB() const;
+
     /** Get the D3D12 parameters */
     nvigi::D3D12Parameters GetD3D12Parameters() const;
 
@@ -45,8 +55,27 @@ public:
 
     const FString GetModelsPath() const;
 
+    /** Loads the GPT on first use, which takes seconds; not on the game thread, see GetGPTAsync */
     FIGIGPT* GetGPT();
 
+    /** The GPT if it is loaded, without loading it; game thread only */
+    FIGIGPT* FindGPT() const;
+
+    /** Loads the GPT on a background thread when it is not loaded yet, then calls OnReady on the game thread with it, or nullptr when it failed to load */
+    void GetGPTAsync(TFunction<void(FIGIGPT*)>&& OnReady);
+
+    /** Releases the GPT if it is idle; the next GetGPT loads it again */
+    void ReleaseGPT();
+
+    /** Dispatcher scaling requests to the relevance of their speaker; game thread only */
+    FIGIInferenceLOD* GetInferenceLOD();
+
+    /** Queue of requests generated ahead of time in idle time; game thread only */
+    FIGIPregeneration* GetPregeneration();
+
+    /** Response baked for this request by UIGIBakeDialogueCommandlet, in the banks under Content/IGI; thread safe */
+    bool FindBakedResponse(const FIGIGPTRequest& Request, FString& OutResponse);
+
     void Test();
 
 private:
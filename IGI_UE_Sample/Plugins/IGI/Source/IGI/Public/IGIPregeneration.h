@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+#include "IGIGPT.h"
+
+#include <atomic>
+
+/**
+ * Requests gameplay expects to send soon, e.g. the greetings of nearby NPCs or the next quest step, generated in idle time.
+ * One at a time, at the lowest priority: only while FIGIGPT has no request pending and the last frame stayed within
+ * PregenerationMaxFrameMs, and any request sent through FIGIGPT::EvaluateAsync meanwhile abandons it at its next token.
+ * Responses wait in a store of PregeneratedResponseCapacity until their request is sent, which EvaluateAsync then answers
+ * at once, or until they expire.
+ *
+ * Game thread only.
+ */
+class IGI_API FIGIPregeneration
+{
+public:
+    FIGIPregeneration();
+
+    /** The request being generated is abandoned */
+    ~FIGIPregeneration();
+
+    /**
+     * Generates Request in idle time unless it is sent within ExpirySeconds; higher Priority first. Anticipating a request
+     * again updates its expiry and priority.
+     */
+    void Anticipate(FIGIGPTRequest&& Request, float ExpirySeconds, int32 Priority = 0);
+
+    /** No longer anticipates Request, and drops its response */
+    void Forget(const FIGIGPTRequest& Request);
+
+    /** Takes the response generated for Request out of the store; false when there is none */
+    bool TakeResponse(const FIGIGPTRequest& Request, FString& OutResponse);
+
+    /** Abandons the request being generated, which is anticipated again; for requests that must not wait for it */
+    void Abandon();
+
+    /** Whether no request is being generated, so that the GPT can be released */
+    bool IsIdle() const { return !InFlight.IsValid(); }
+
+    struct FStats
+    {
+        int32 NumAnticipated{ 0 };
+        int32 NumGenerated{ 0 };
+        int32 NumServed{ 0 };
+        int32 NumAbandoned{ 0 };
+        int32 NumExpired{ 0 };
+        int32 NumEvicted{ 0 };
+        int32 NumQueued{ 0 };
+        int32 NumStored{ 0 };
+    };
+    FStats GetStats() const;
+
+private:
+    struct FAnticipatedRequest
+    {
+        FIGIGPTRequest Request;
+        double ExpirySeconds{ 0.0 };
+        int32 Priority{ 0 };
+    };
+
+    struct FStoredResponse
+    {
+        FIGIGPTRequest Request;
+        FString Response;
+        double ExpirySeconds{ 0.0 };
+    };
+
+    /** Shared with the evaluating thread */
+    struct FInFlight
+    {
+        FAnticipatedRequest Anticipated;
+        std::atomic<bool> bAbandoned{ false };
+    };
+
+    bool Tick(float DeltaTime);
+    void StartTicking();
+    void RemoveExpired(double NowSeconds);
+    void OnGenerated(const TSharedRef<FInFlight, ESPMode::ThreadSafe>& Generated, FString&& Response);
+    void Store(FAnticipatedRequest&& Anticipated, FString&& Response);
+
+    TArray<FAnticipatedRequest> Queue;
+    TArray<FStoredResponse> Responses;
+    TSharedPtr<FInFlight, ESPMode::ThreadSafe> InFlight;
+
+    FTSTicker::FDelegateHandle TickHandle;
+    FStats Stats;
+
+    // Cleared on destruction, for the request being evaluated
+    TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> bAlive;
+};
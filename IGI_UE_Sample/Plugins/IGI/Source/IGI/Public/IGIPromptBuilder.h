@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGIGPT.h"
+#include "IGISavedConversation.h"
+
+enum class EIGIPromptSection : uint8
+{
+    System,
+    Memory,
+    History,
+    Context,
+    User,
+
+    Num
+};
+
+struct FIGIPromptTurn
+{
+    FString Speaker;
+    FString Text;
+};
+
+/**
+ * Assembles GPT requests from a system, a memory, a history, a context and a user section, each held to its own token budget.
+ * The budgets together always fit in the model's context with room left for the response, so prefill cost stays
+ * bounded however long a session runs. History that does not fit is evicted oldest turn first; SummarizeHistoryAsync
+ * folds evicted turns into a running summary that is kept at the top of the history section.
+ * Sections are emitted in a stable order (system, memory, history, context) so that consecutive prompts share a long prefix;
+ * the game state context changes the most and comes last.
+ *
+ * Builders may outlive the GPT, which FIGIModule::ReleaseGPT releases between PIE sessions; the calls that need the model
+ * resolve it through FIGIModule::GetGPT each time. Game thread only.
+ */
+class IGI_API FIGIPromptBuilder
+{
+public:
+    FIGIPromptBuilder();
+
+    /** Sets the budget of a section, clamped so that all sections still fit in the context */
+    void SetBudget(EIGIPromptSection Section, int32 NumTokens);
+    int32 GetBudget(EIGIPromptSection Section) const;
+
+    void SetSystemPrompt(FString&& SystemPrompt);
+    void SetMemory(FString&& Memory);
+
+    /** Game state for the next requests, typically from UIGIContextComponent::BuildContext */
+    void SetContext(FString&& Context);
+
+    /** LoRA adapter set on every request of this session, e.g. the persona of the NPC it belongs to */
+    void SetAdapter(FName Adapter);
+    void AddTurn(FString&& Speaker, FString&& Text);
+    void ResetHistory();
+
+    const TArray<FIGIPromptTurn>& GetHistory() const;
+    const FString& GetSummary() const;
+
+    /** Builds the request for UserPrompt, evicting history that no longer fits in its budget */
+    FIGIGPTRequest Build(FString&& UserPrompt);
+
+    /** Token count of the prompt produced by the last call to Build */
+    int32 GetLastPromptTokens() const;
+
+    /** Whether evicted turns are waiting to be folded into the summary */
+    bool HasTurnsToSummarize() const;
+
+    /**
+     * Summarizes evicted turns into the running summary through FIGIGPT::EvaluateWhenIdle, so after any pending request,
+     * draft or pre-generation. Does nothing while a summary is already in progress.
+     */
+    void SummarizeHistoryAsync();
+
+    /** Captures the session for a save game */
+    FIGISavedConversation SaveSession() const;
+
+    /** Restores a session saved by SaveSession; the next request replays the restored text */
+    void RestoreSession(const FIGISavedConversation& Saved);
+
+private:
+    struct FState;
+
+    FString TruncateToBudget(const FString& Text, int32 NumTokens, bool bKeepEnd) const;
+    int32 GetAvailableTokens() const;
+
+    TSharedRef<FState> State;
+};
@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "IGIReplicatedResponseComponent.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FIGIReplicatedResponseEvent, const FString&, Response);
+
+/** Response as a client first receives it, whether it is still being generated or not */
+USTRUCT()
+struct FIGIReplicatedResponseSnapshot
+{
+    GENERATED_BODY()
+
+    /** Increases with every response the server generates; 0 before the first */
+    UPROPERTY()
+    int32 ResponseId{ 0 };
+
+    UPROPERTY()
+    FString Text;
+
+    UPROPERTY()
+    bool bComplete{ false };
+};
+
+/**
+ * Response of an NPC generated on the server and streamed to clients. Only the server runs inference; the text generated
+ * since the last flush goes out every FlushInterval as a reliable multicast delta carrying its offset, so the growing response
+ * is never resent. Multicasts only reach the connections the owner is relevant to, so the owner's NetCullDistanceSquared
+ * decides which clients hear the NPC. A client the owner becomes relevant to while, or after, it speaks receives the response
+ * so far once, as the initial snapshot of its channel, then the deltas that follow.
+ *
+ * To try it, play in editor as a listen server with a client, call GenerateResponse on the server and compare the
+ * OnResponseUpdated events on both; IGI.Net.Stats compares the bytes sent with replicating the whole response.
+ *
+ * Game thread only.
+ */
+UCLASS(ClassGroup = (IGI), meta = (BlueprintSpawnableComponent))
+class IGI_API UIGIReplicatedResponseComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UIGIReplicatedResponseComponent();
+
+    /** Server only: generates a response to the prompts, replacing the one being generated if any */
+    UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "IGI|Net")
+    void GenerateResponse(const FString& SystemPrompt, const FString& UserPrompt, const FString& AssistantPrompt);
+
+    /** Response so far */
+    UFUNCTION(BlueprintPure, Category = "IGI|Net")
+    const FString& GetResponse() const { return Snapshot.Text; }
+
+    UFUNCTION(BlueprintPure, Category = "IGI|Net")
+    bool IsResponseComplete() const { return Snapshot.bComplete; }
+
+    /** On the server and every client the owner is relevant to, with the response so far, whenever it grows */
+    UPROPERTY(BlueprintAssignable, Category = "IGI|Net")
+    FIGIReplicatedResponseEvent OnResponseUpdated;
+
+    /** On the server and every client the owner is relevant to, with the whole response */
+    UPROPERTY(BlueprintAssignable, Category = "IGI|Net")
+    FIGIReplicatedResponseEvent OnResponseCompleted;
+
+    /** Time generated text is gathered for before it is sent, in s; longer sends fewer, larger deltas */
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IGI|Net", meta = (ClampMin = "0", Units = "s"))
+    float FlushInterval{ 0.1f };
+
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+    /** What the server sent, against replicating the whole response at every flush; for the IGI.Net.Stats console command */
+    struct FStats
+    {
+        uint64 NumResponses{ 0 };
+        uint64 NumDeltas{ 0 };
+        uint64 DeltaBytes{ 0 };
+        uint64 FullResponseBytes{ 0 };
+    };
+    static const FStats& GetStats();
+
+private:
+    /** Shared with the evaluating thread, which must not touch the component */
+    struct FStream
+    {
+        FCriticalSection CS;
+        FString PendingText;
+        bool bComplete{ false };
+        bool bCancelled{ false };
+    };
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastAppendResponse(int32 ResponseId, int32 Offset, const FString& Delta, bool bComplete);
+
+    UFUNCTION()
+    void OnRep_Snapshot();
+
+    void CancelStream();
+    void Flush();
+
+    UPROPERTY(ReplicatedUsing = OnRep_Snapshot)
+    FIGIReplicatedResponseSnapshot Snapshot;
+
+    // Server only
+    TSharedPtr<FStream, ESPMode::ThreadSafe> Stream;
+    int32 NextResponseId{ 1 };
+    int32 SentLength{ 0 };
+    float SecondsSinceFlush{ 0.0f };
+};
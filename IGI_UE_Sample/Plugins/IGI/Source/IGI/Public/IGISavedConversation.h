@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "IGISavedConversation.generated.h"
+
+USTRUCT(BlueprintType)
+struct IGI_API FIGISavedTurn
+{
+    GENERATED_BODY()
+
+    UPROPERTY(SaveGame, BlueprintReadOnly, Category = "IGI|Conversation")
+    FString Speaker;
+
+    UPROPERTY(SaveGame, BlueprintReadOnly, Category = "IGI|Conversation")
+    FString Text;
+};
+
+/**
+ * A conversation session as stored in a save game; see FIGIPromptBuilder::SaveSession and RestoreSession.
+ * Text only: nvigi cannot read or write the backend's context (KV) state, so the first request after loading prefills
+ * the restored conversation like any other.
+ */
+USTRUCT(BlueprintType)
+struct IGI_API FIGISavedConversation
+{
+    GENERATED_BODY()
+
+    UPROPERTY(SaveGame)
+    FString SystemPrompt;
+
+    UPROPERTY(SaveGame)
+    FString Memory;
+
+    UPROPERTY(SaveGame)
+    FString Context;
+
+    UPROPERTY(SaveGame)
+    FString Summary;
+
+    UPROPERTY(SaveGame)
+    FName Adapter;
+
+    UPROPERTY(SaveGame, BlueprintReadOnly, Category = "IGI|Conversation")
+    TArray<FIGISavedTurn> History;
+
+    /** Evicted turns not folded into the summary yet */
+    UPROPERTY(SaveGame)
+    TArray<FIGISavedTurn> TurnsToSummarize;
+};
@@ -0,0 +1,285 @@
+// SPDX-FileCopyrightText: Copyright (c) SPACE KIWI STUDIO. All rights reserved.
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+
+#include "IGISettings.generated.h"
+
+UENUM()
+enum class EIGIAdapterPolicy : uint8
+{
+    /** Adapter with the most recent architecture */
+    HighestArchitecture,
+
+    /** Adapter with the most dedicated video memory */
+    MostVideoMemory,
+
+    /** First adapter of PreferredVendorId, highest architecture among them */
+    PreferredVendor,
+
+    /** Adapter at AdapterIndex in the list reported by nvigi */
+    AdapterIndex,
+};
+
+UENUM()
+enum class EIGIGPTHostMode : uint8
+{
+    /** This process loads the model and runs inference for itself */
+    InProcess,
+
+    /** This process loads the model and also serves other local processes over the loopback interface */
+    Server,
+
+    /** This process forwards its requests to a local server process and never loads the model */
+    Client,
+
+    /** This process launches a headless child process that loads the model, and talks to it over shared memory */
+    Worker,
+};
+
+UENUM()
+enum class EIGIGPTBackend : uint8
+{
+    /** GGML on the inference adapter through CUDA, with compute in graphics when it is the render adapter */
+    Cuda,
+
+    /** GGML on the CPU; leaves the GPU to the game on machines where it is the bottleneck */
+    Cpu,
+
+    /** Filler tokens with the timings of the Synthetic category, without a model or a GPU; measures the plugin's own overhead */
+    Synthetic,
+};
+
+UENUM()
+enum class EIGIInferenceSource : uint8
+{
+    /** Generated by the model */
+    Generate,
+
+    /** A cached response to the same prompt when there is one, generated otherwise */
+    CacheOrGenerate,
+
+    /** A cached response to the same prompt when there is one, the caller's canned text otherwise; never generates */
+    CacheOrCanned,
+
+    /** The caller's canned text */
+    Canned,
+};
+
+/** How requests of a given relevance are served; see FIGIInferenceLOD */
+USTRUCT()
+struct FIGIInferenceLODTier
+{
+    GENERATED_BODY()
+
+    /** Lowest relevance served by this tier, from 0 to 1 */
+    UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = "0", ClampMax = "1"))
+    float MinRelevance{ 0.0f };
+
+    UPROPERTY(EditAnywhere, Category = "LOD")
+    EIGIInferenceSource Source{ EIGIInferenceSource::Generate };
+
+    /** Tokens generated at most; 0 for the model's limit */
+    UPROPERTY(EditAnywhere, Category = "LOD", meta = (ClampMin = "0"))
+    int32 MaxTokens{ 0 };
+
+    /** Queued requests of a higher priority are evaluated first */
+    UPROPERTY(EditAnywhere, Category = "LOD")
+    int32 Priority{ 0 };
+
+    /** Apply the request's LoRA adapter. Without it the base model answers. */
+    UPROPERTY(EditAnywhere, Category = "LOD")
+    bool bUseAdapter{ true };
+};
+
+/** Project settings of the IGI plugin, in Project Settings > Plugins > IGI */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "IGI"))
+class IGI_API UIGISettings : public UDeveloperSettings
+{
+    GENERATED_BODY()
+
+public:
+    UIGISettings();
+
+    /** How the inference adapter is picked among the adapters nvigi detected. Only the D3D12 RHI can run inference on another adapter than the render one. */
+    UPROPERTY(config, EditAnywhere, Category = "Adapter")
+    EIGIAdapterPolicy AdapterPolicy{ EIGIAdapterPolicy::HighestArchitecture };
+
+    /** PCI vendor id used by the PreferredVendor policy, e.g. 0x10DE for NVIDIA */
+    UPROPERTY(config, EditAnywhere, Category = "Adapter", meta = (EditCondition = "AdapterPolicy == EIGIAdapterPolicy::PreferredVendor"))
+    int32 PreferredVendorId{ 0x10DE };
+
+    /** Index used by the AdapterIndex policy */
+    UPROPERTY(config, EditAnywhere, Category = "Adapter", meta = (EditCondition = "AdapterPolicy == EIGIAdapterPolicy::AdapterIndex", ClampMin = "0"))
+    int32 AdapterIndex{ 0 };
+
+    /**
+     * Pick among the adapters the engine does not render on, when there are any. D3D12 only.
+     * Inference then runs on a D3D12 device of its own on that adapter, sharing nothing with the renderer.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Adapter")
+    bool bAvoidRenderAdapter{ false };
+
+    /** Hand nvigi a dedicated compute queue instead of the engine's graphics queue. D3D12 only. */
+    UPROPERTY(config, EditAnywhere, Category = "Adapter")
+    bool bUseDedicatedComputeQueue{ false };
+
+    /** Where the GPT model is hosted. Can be overridden per process with -IGIHostMode=InProcess|Server|Client|Worker. */
+    UPROPERTY(config, EditAnywhere, Category = "Server")
+    EIGIGPTHostMode HostMode{ EIGIGPTHostMode::InProcess };
+
+    /** Loopback port of the GPT server. Can be overridden per process with -IGIServerPort=. */
+    UPROPERTY(config, EditAnywhere, Category = "Server", meta = (ClampMin = "1024", ClampMax = "65535"))
+    int32 ServerPort{ 41800 };
+
+    /** Model to load; every quantization of it found among the models is a candidate variant */
+    UPROPERTY(config, EditAnywhere, Category = "Model")
+    FString ModelName{ TEXT("nemotron-4-mini-4b-instruct") };
+
+    /** Loads this model GUID as is, without any variant selection, when set */
+    UPROPERTY(config, EditAnywhere, Category = "Model")
+    FString ModelGUID;
+
+    /** Video memory the model may use, in MB. Variants that need more are skipped. */
+    UPROPERTY(config, EditAnywhere, Category = "Model", meta = (ClampMin = "0"))
+    int32 ModelMemoryBudgetMB{ 8192 };
+
+    /** Video memory left to the game on the inference adapter when comparing variants against free memory, in MB */
+    UPROPERTY(config, EditAnywhere, Category = "Model", meta = (ClampMin = "0"))
+    int32 MemoryHeadroomMB{ 1024 };
+
+    /** Variants generating slower than this are replaced by a smaller one, measured with a short probe at load. 0 skips the probe. */
+    UPROPERTY(config, EditAnywhere, Category = "Model", meta = (ClampMin = "0", Units = "ms"))
+    float MaxMillisecondsPerToken{ 0.0f };
+
+    /**
+     * Video memory LoRA adapters may use on top of the model, in MB. Adapters are loaded with the model, in the order it lists
+     * them, until they exceed it; requests for the others run on the base model.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Model", meta = (ClampMin = "0"))
+    int32 LoRAMemoryBudgetMB{ 512 };
+
+    /**
+     * Editor only: keep the model loaded when a PIE session ends. When off it is released, unless requests are in flight,
+     * and the next FIGIModule::GetGPT reloads it; FIGIGPT pointers must not outlive the session.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Model")
+    bool bKeepModelLoadedAcrossPIE{ true };
+
+    /**
+     * Quantizations of ModelName packaged with the game, e.g. q4_0; all of them when empty. Other models are not
+     * packaged, and a ModelGUID is packaged whatever its quantization. Read at build time with ModelName and ModelGUID,
+     * so all three can be set per platform in the platform's Game.ini.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Model")
+    TArray<FString> PackagedQuantizations;
+
+    /** Which backend runs the GPT model. Can be overridden per process with -IGIGPTBackend=Cuda|Cpu|Synthetic. */
+    UPROPERTY(config, EditAnywhere, Category = "CPU")
+    EIGIGPTBackend GPTBackend{ EIGIGPTBackend::Cuda };
+
+    /**
+     * Threads of the CPU backend. 0 benchmarks a few thread counts the first time the model loads on a machine, and keeps
+     * the fastest in the user settings.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "CPU", meta = (EditCondition = "GPTBackend == EIGIGPTBackend::Cpu", ClampMin = "0"))
+    int32 CPUThreadCount{ 0 };
+
+    /** Keep the CPU backend's threads off the cores of the game, render and RHI threads. Windows only. */
+    UPROPERTY(config, EditAnywhere, Category = "CPU", meta = (EditCondition = "GPTBackend == EIGIGPTBackend::Cpu"))
+    bool bPinCPUInferenceThreads{ true };
+
+    /**
+     * Give the CPU backend fewer threads while the game or render thread nears CPUFrameBudgetMs, and more once it is back
+     * under, up to CPUThreadCount or the tuned count. The thread count is fixed per instance, so the model is reloaded
+     * between requests for it, at most every few seconds.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "CPU", meta = (EditCondition = "GPTBackend == EIGIGPTBackend::Cpu"))
+    bool bAdaptCPUThreadsToGameLoad{ true };
+
+    /** Game and render thread time per frame the CPU backend must not push the game beyond */
+    UPROPERTY(config, EditAnywhere, Category = "CPU", meta = (EditCondition = "GPTBackend == EIGIGPTBackend::Cpu && bAdaptCPUThreadsToGameLoad", ClampMin = "1", Units = "ms"))
+    float CPUFrameBudgetMs{ 16.67f };
+
+    /**
+     * Inference level of detail: each request is served by the tier with the highest MinRelevance its relevance reaches.
+     * Set per platform in the platform's Game.ini to scale inference with what the platform can afford.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "LOD")
+    TArray<FIGIInferenceLODTier> InferenceLODTiers;
+
+    /** Distance up to which a speaker is fully relevant, in cm */
+    UPROPERTY(config, EditAnywhere, Category = "LOD", meta = (ClampMin = "0", Units = "cm"))
+    float RelevanceNearDistance{ 500.0f };
+
+    /** Distance beyond which a speaker is not relevant at all, in cm */
+    UPROPERTY(config, EditAnywhere, Category = "LOD", meta = (ClampMin = "0", Units = "cm"))
+    float RelevanceFarDistance{ 5000.0f };
+
+    /**
+     * Tokens generated per second at most by the tiers below the highest priority; beyond it their requests are served
+     * from the cache or their canned text. 0 for no limit.
+     */
+    UPROPERTY(config, EditAnywhere, Category = "LOD", meta = (ClampMin = "0"))
+    int32 InferenceTokensPerSecond{ 0 };
+
+    /** Requests waiting for the model at most; beyond it the lowest priority one is answered with its canned text */
+    UPROPERTY(config, EditAnywhere, Category = "LOD", meta = (ClampMin = "1"))
+    int32 MaxQueuedInferenceRequests{ 16 };
+
+    /** Responses kept for the cached tiers */
+    UPROPERTY(config, EditAnywhere, Category = "LOD", meta = (ClampMin = "0"))
+    int32 InferenceResponseCacheSize{ 256 };
+
+    /** Time the synthetic backend takes before its first token, in ms */
+    UPROPERTY(config, EditAnywhere, Category = "Synthetic", meta = (ClampMin = "0", Units = "ms"))
+    float SyntheticPrefillMs{ 50.0f };
+
+    /** Time the synthetic backend takes per token, in ms */
+    UPROPERTY(config, EditAnywhere, Category = "Synthetic", meta = (ClampMin = "0", Units = "ms"))
+    float SyntheticMillisecondsPerToken{ 20.0f };
+
+    /** Tokens in every synthetic response */
+    UPROPERTY(config, EditAnywhere, Category = "Synthetic", meta = (ClampMin = "0"))
+    int32 SyntheticResponseTokens{ 32 };
+
+    /** Share of synthetic requests that fail halfway through their response */
+    UPROPERTY(config, EditAnywhere, Category = "Synthetic", meta = (ClampMin = "0", ClampMax = "1"))
+    float SyntheticFailureRate{ 0.0f };
+
+    /** Answer requests baked by the IGIBakeDialogue commandlet from their bank instead of the model */
+    UPROPERTY(config, EditAnywhere, Category = "Bake")
+    bool bUseBakedDialogue{ true };
+
+    /**
+     * Evaluate the request the player is still typing (see FIGIGPT::UpdateDraft) while no other request is pending,
+     * so that sending it only waits for what is left of its response
+     */
+    UPROPERTY(config, EditAnywhere, Category = "Speculation")
+    bool bEvaluateDrafts{ true };
+
+    /** Time a draft must stay unchanged before it is evaluated, in s */
+    UPROPERTY(config, EditAnywhere, Category = "Speculation", meta = (EditCondition = "bEvaluateDrafts", ClampMin = "0", Units = "s"))
+    float DraftDebounceSeconds{ 0.4f };
+
+    /** Responses generated ahead of time for anticipated requests (see FIGIPregeneration) kept at most */
+    UPROPERTY(config, EditAnywhere, Category = "Pregeneration", meta = (ClampMin = "0"))
+    int32 PregeneratedResponseCapacity{ 64 };
+
+    /** Anticipated requests are only generated after frames that took at most this, in ms; 0 for any frame */
+    UPROPERTY(config, EditAnywhere, Category = "Pregeneration", meta = (ClampMin = "0", Units = "ms"))
+    float PregenerationMaxFrameMs{ 33.3f };
+
+    /** Host mode after applying the command line override */
+    EIGIGPTHostMode GetHostMode() const;
+
+    /** Server port after applying the command line override */
+    int32 GetServerPort() const;
+
+    /** GPT backend after applying the command line override */
+    EIGIGPTBackend GetGPTBackend() const;
+};